@@ -1,17 +1,27 @@
 #include "app.hpp"
+#include "asset_pack.hpp"
+#include "../resources/ui_filters.hpp"
 #include "../output/image.hpp"
 #include "../output/audio.hpp"
 #include "../util/qsprintf/qsprintf.hpp"
+#include "../util/profiler.hpp"
+#include "../util/startup_timer.hpp"
+#include "../util/thread_pool.hpp"
 
 #include <filesystem>
+#include <thread>
+#include <atomic>
 #include <array>
 #include <cassert>
+#include <cstdlib>
 #include <cstring>
+#include <new>
 
 
-#ifndef NDEBUG
 #include <cstdio>
-#else
+
+// fprintf(stderr, ...) reports what a release build must not hide
+#ifdef NDEBUG
 #define printf(fmt, ...)
 #endif
 
@@ -32,7 +42,7 @@ using Music = audio::Music;
 
 namespace
 {
-    static Rect2Du32 to_rect(u16 x, u16 y, u32 width, u32 height)
+    static constexpr Rect2Du32 to_rect(u16 x, u16 y, u32 width, u32 height)
     {
         Rect2Du32 range{};
         range.x_begin = x;
@@ -131,36 +141,6 @@ namespace
     const auto MOUSE_IMAGE_PATH = ASSETS_DIR / "mouse.png";
     const auto CONTROLLER_IMAGE_PATH = ASSETS_DIR / "controller.png";
     const auto ASCII_IMAGE_PATH = ASSETS_DIR / "ascii.png";
-
-
-    inline bool load_image(fs::path const& path, Image& image)
-    {
-        return img::read_image_from_file(path.string().c_str(), image);
-    }
-
-
-    bool load_keyboard_image(Image& image)
-    {        
-        return load_image(KEYBOARD_IMAGE_PATH, image);
-    }
-
-
-    bool load_mouse_image(Image& image)
-    {
-        return load_image(MOUSE_IMAGE_PATH, image);
-    }
-
-
-    bool load_controller_image(Image& image)
-    {
-        return load_image(CONTROLLER_IMAGE_PATH, image);
-    }
-    
-
-    bool load_ascii_image(Image& image)
-    {
-        return load_image(ASCII_IMAGE_PATH, image);
-    }
 }
 
 
@@ -171,53 +151,17 @@ namespace
     // https://www.kenney.nl/
     // https://pixabay.com/music/
 
-    const auto LASER_SOUND_PATH = ASSETS_DIR / "laserLarge_000.ogg";
-    const auto RETRO_SOUND_PATH = ASSETS_DIR / "laserRetro_003.ogg";
-    const auto DOOR_SOUND_PATH = ASSETS_DIR / "doorOpen_000.ogg";
-    const auto FORCE_FIELD_SOUND_PATH = ASSETS_DIR / "forceField_000.ogg";
-    const auto MELLOW_MUSIC_PATH = ASSETS_DIR / "mellow-future-bass-bounce-on-it-184234.mp3";
-
-
-    inline bool load_sound(fs::path const& path, Sound& sound)
-    {
-        return audio::load_sound_from_file(path.string().c_str(), sound);
-    }
-
-
-    inline bool load_music(fs::path const& path, Music& music)
-    {
-        return audio::load_music_from_file(path.string().c_str(), music);
-    }
-
-
-    bool load_laser_sound(Sound& sound)
-    {
-        return load_sound(LASER_SOUND_PATH, sound);
-    }
-
-
-    bool load_retro_sound(Sound& sound)
-    {
-        return load_sound(RETRO_SOUND_PATH, sound);
-    }
-
-
-    bool load_door_sound(Sound& sound)
-    {
-        return load_sound(DOOR_SOUND_PATH, sound);
-    }
-
-
-    bool load_force_field_sound(Sound& sound)
-    {
-        return load_sound(FORCE_FIELD_SOUND_PATH, sound);
-    }
-
-
-    bool load_mellow_music(Music& music)
-    {
-        return load_music(MELLOW_MUSIC_PATH, music);
-    }
+    constexpr auto LASER_SOUND_FILE = "laserLarge_000.ogg";
+    constexpr auto RETRO_SOUND_FILE = "laserRetro_003.ogg";
+    constexpr auto DOOR_SOUND_FILE = "doorOpen_000.ogg";
+    constexpr auto FORCE_FIELD_SOUND_FILE = "forceField_000.ogg";
+    constexpr auto MELLOW_MUSIC_FILE = "mellow-future-bass-bounce-on-it-184234.mp3";
+
+    const auto LASER_SOUND_PATH = ASSETS_DIR / LASER_SOUND_FILE;
+    const auto RETRO_SOUND_PATH = ASSETS_DIR / RETRO_SOUND_FILE;
+    const auto DOOR_SOUND_PATH = ASSETS_DIR / DOOR_SOUND_FILE;
+    const auto FORCE_FIELD_SOUND_PATH = ASSETS_DIR / FORCE_FIELD_SOUND_FILE;
+    const auto MELLOW_MUSIC_PATH = ASSETS_DIR / MELLOW_MUSIC_FILE;
 }
 
 
@@ -259,7 +203,9 @@ namespace
     }
 
 
-    u8 to_filter_color_id(Pixel p)
+    // lambdas give each image kernel instantiation a unique type so the callback is inlined
+
+    constexpr auto to_filter_color_id = [](Pixel p)
     {
         if (p.alpha == 0)
         {
@@ -272,23 +218,36 @@ namespace
         }
 
         return to_u8(ColorId::White);
-    }
+    };
 
 
-    bool can_set_color_id(u8 current_id)
+    constexpr auto can_set_color_id = [](u8 current_id)
     {
         return current_id > to_u8(ColorId::Black);
-    }
+    };
 
 
-    Pixel to_render_color(u8 mask, Pixel color)
+    constexpr img::Palette make_render_palette()
     {
-        if (mask == 0)
+        img::Palette palette{};
+
+        for (u32 i = 0; i < palette.count; i++)
         {
-            return color;
+            palette.colors[i] = i < COLOR_TABLE.size() ? COLOR_TABLE[i] : TRANSPARENT;
         }
 
-        return COLOR_TABLE[mask];
+        return palette;
+    }
+
+
+    static constexpr auto RENDER_PALETTE = make_render_palette();
+
+
+    // ui masks are composed onto the screen as an indexed blit with a transparent key
+    template <class SRC>
+    inline void render_mask(SRC const& mask, SubView const& dst, img::DirtyRects const& dirty)
+    {
+        img::transform_palette(mask, dst, RENDER_PALETTE, to_u8(ColorId::Trasnparent), dirty);
     }
 
 }
@@ -483,85 +442,126 @@ namespace
     };
 
 
-    static void make_keyboard_filter(UIKeyboardFilter& keyboard)
+    // what the panels show
+    class UIState
     {
-        auto& view = keyboard.filter;
-        
-        keyboard.key_1 = img::sub_view(view, to_rect(21,  3, 14, 14));
-        keyboard.key_2 = img::sub_view(view, to_rect(39,  3, 14, 14));
-        keyboard.key_3 = img::sub_view(view, to_rect(57,  3, 14, 14));
-        keyboard.key_4 = img::sub_view(view, to_rect(75,  3, 14, 14));
-        keyboard.key_w = img::sub_view(view, to_rect(48, 21, 14, 14));
-        keyboard.key_a = img::sub_view(view, to_rect(35, 39, 14, 14));
-        keyboard.key_s = img::sub_view(view, to_rect(53, 39, 14, 14));
-        keyboard.key_d = img::sub_view(view, to_rect(71, 39, 14, 14));
-        keyboard.key_space = img::sub_view(view, to_rect(84, 75, 104, 14));
-    }
+    public:
+        UICommand command;
+
+        Point2Di32 mouse_pos;
+        b8 song_playing;
+    };
 
 
-    static void make_mouse_filter(UIMouseFilter& mouse)
+    // sub view rects in member order, the pack is checked against these when the app compiles
+
+    constexpr Rect2Du32 KEYBOARD_RECTS[UIKeyboardFilter::count] =
     {
-        auto& view = mouse.filter;
+        to_rect(21,  3, 14, 14), // key_1
+        to_rect(39,  3, 14, 14), // key_2
+        to_rect(57,  3, 14, 14), // key_3
+        to_rect(75,  3, 14, 14), // key_4
+        to_rect(48, 21, 14, 14), // key_w
+        to_rect(35, 39, 14, 14), // key_a
+        to_rect(53, 39, 14, 14), // key_s
+        to_rect(71, 39, 14, 14), // key_d
+        to_rect(84, 75, 104, 14), // key_space
+    };
 
-        mouse.btn_left   = img::sub_view(view, to_rect( 2, 2, 28, 29));
-        mouse.btn_middle = img::sub_view(view, to_rect(34, 2, 12, 29));
-        mouse.btn_right  = img::sub_view(view, to_rect(50, 2, 28, 29));
-    }
+
+    constexpr Rect2Du32 MOUSE_RECTS[UIMouseFilter::count] =
+    {
+        to_rect( 2, 2, 28, 29), // btn_left
+        to_rect(34, 2, 12, 29), // btn_middle
+        to_rect(50, 2, 28, 29), // btn_right
+    };
 
 
-    static void make_controller_filter(UIController& controller)
+    constexpr Rect2Du32 CONTROLLER_RECTS[UIController::count] =
     {
-        auto& view = controller.filter;
+        to_rect(22, 33,  9, 16), // btn_dpad_up
+        to_rect(22, 60,  9, 16), // btn_dpad_down
+        to_rect( 5, 50, 16,  9), // btn_dpad_left
+        to_rect(32, 50, 16,  9), // btn_dpad_right
+
+        to_rect(159, 63, 13, 13), // btn_a
+        to_rect(174, 48, 13, 13), // btn_b
+        to_rect(144, 48, 13, 13), // btn_x
+        to_rect(159, 33, 13, 13), // btn_y
+
+        to_rect(103, 24, 14, 7), // btn_start
+        to_rect( 75, 24, 14, 7), // btn_back
+
+        to_rect( 18, 22, 17,  7), // btn_sh_left
+        to_rect(157, 22, 17,  7), // btn_sh_right
+        to_rect( 18,  5, 17, 13), // btn_tr_left
+        to_rect(157,  5, 17, 13), // btn_tr_right
+
+        to_rect( 60, 45, 23, 23), // btn_st_left
+        to_rect(109, 45, 23, 23), // btn_st_right
+    };
 
-        controller.btn_dpad_up    = img::sub_view(view, to_rect(22, 33,  9, 16));
-        controller.btn_dpad_down  = img::sub_view(view, to_rect(22, 60,  9, 16));
-        controller.btn_dpad_left  = img::sub_view(view, to_rect( 5, 50, 16,  9));
-        controller.btn_dpad_right = img::sub_view(view, to_rect(32, 50, 16,  9));
 
-        controller.btn_a = img::sub_view(view, to_rect(159, 63, 13, 13));
-        controller.btn_b = img::sub_view(view, to_rect(174, 48, 13, 13));
-        controller.btn_x = img::sub_view(view, to_rect(144, 48, 13, 13));
-        controller.btn_y = img::sub_view(view, to_rect(159, 33, 13, 13));
+    // glyph widths from ' ' to '~', each glyph is the height of the mask
+    constexpr u32 ASCII_WIDTHS[AsciiFilter::count] = { 2, 4, 4, 6, 6, 5, 6, 5, 5, 5, 5, 5, 4, 5, 4, 5, 5, 4, 5, 5, 5, 5, 5, 5, 5, 5, 4, 4, 4, 5, 4, 5, 6, 5, 5, 5, 5, 5, 5, 5, 5, 4, 5, 5, 5, 6, 5, 5, 5, 5, 5, 5, 6, 5, 6, 6, 5, 6, 5, 3, 5, 3, 4, 4, 4, 5, 5, 5, 5, 5, 5, 5, 5, 4, 5, 5, 5, 6, 5, 5, 5, 5, 5, 5, 6, 5, 6, 6, 5, 6, 5, 4, 4, 4, 5 };
 
-        controller.btn_start = img::sub_view(view, to_rect(103, 24, 14, 7));
-        controller.btn_back  = img::sub_view(view, to_rect( 75, 24, 14, 7));
 
-        controller.btn_sh_left  = img::sub_view(view, to_rect( 18, 22, 17,  7));
-        controller.btn_sh_right = img::sub_view(view, to_rect(157, 22, 17, 7));
-        controller.btn_tr_left  = img::sub_view(view, to_rect( 18,  5, 17, 13));
-        controller.btn_tr_right = img::sub_view(view, to_rect(157,  5, 17, 13));
+    static void make_sub_filters(GrayView const& view, Rect2Du32 const* rects, SubFilter* sub_filters, u32 count)
+    {
+        for (u32 i = 0; i < count; i++)
+        {
+            sub_filters[i] = img::sub_view(view, rects[i]);
+        }
+    }
 
-        controller.btn_st_left  = img::sub_view(view, to_rect( 60, 45, 23, 23));
-        controller.btn_st_right = img::sub_view(view, to_rect(109, 45, 23, 23));
+
+    static void make_keyboard_filter(UIKeyboardFilter& keyboard)
+    {
+        make_sub_filters(keyboard.filter, KEYBOARD_RECTS, keyboard.keys, keyboard.count);
     }
 
 
-    static void make_ascii_filter(AsciiFilter& ascii, u32 scale)
+    static void make_mouse_filter(UIMouseFilter& mouse)
     {
-        auto& view = ascii.filter;
-        auto& characters = ascii.characters;
+        make_sub_filters(mouse.filter, MOUSE_RECTS, mouse.buttons, mouse.count);
+    }
 
-        u32 char_length[ascii.count] = { 2, 4, 4, 6, 6, 5, 6, 5, 5, 5, 5, 5, 4, 5, 4, 5, 5, 4, 5, 5, 5, 5, 5, 5, 5, 5, 4, 4, 4, 5, 4, 5, 6, 5, 5, 5, 5, 5, 5, 5, 5, 4, 5, 5, 5, 6, 5, 5, 5, 5, 5, 5, 6, 5, 6, 6, 5, 6, 5, 3, 5, 3, 4, 4, 4, 5, 5, 5, 5, 5, 5, 5, 5, 4, 5, 5, 5, 6, 5, 5, 5, 5, 5, 5, 6, 5, 6, 6, 5, 6, 5, 4, 4, 4, 5 };
 
-        constexpr auto char_length_count = sizeof(char_length) / sizeof(u32);
-        static_assert(char_length_count == ascii.count);
+    static void make_controller_filter(UIController& controller)
+    {
+        make_sub_filters(controller.filter, CONTROLLER_RECTS, controller.buttons, controller.count);
+    }
 
-        constexpr auto black_id = to_u8(ColorId::Black);
+
+    static void make_ascii_filter(AsciiFilter& ascii, u32 scale)
+    {
+        auto& view = ascii.filter;
+        auto& characters = ascii.characters;
 
         u32 x = 0;
         for (u32 i = 0; i < ascii.count; i++)
         {
-            auto width = char_length[i] * scale;
+            auto width = ASCII_WIDTHS[i] * scale;
             characters[i] = img::sub_view(view, to_rect(x, 0, width, view.height));
 
-            img::fill_if(characters[i], black_id, can_set_color_id);
-
             x += width;
         }
     }
 
 
-    static void write_to_view(AsciiFilter const& filter, sv::StringView const& src, SubView const& dst)
+    // characters are drawn solid, baked into the asset pack
+    static void fill_ascii_filter(AsciiFilter& ascii)
+    {
+        constexpr auto black_id = to_u8(ColorId::Black);
+
+        for (u32 i = 0; i < ascii.count; i++)
+        {
+            img::fill_if(ascii.characters[i], black_id, can_set_color_id);
+        }
+    }
+
+
+    static void write_to_view(AsciiFilter const& filter, sv::StringView const& src, SubView const& dst, img::DirtyRects const& dirty)
     {
         u32 const height = std::min(filter.filter.height, dst.height);
         
@@ -584,7 +584,7 @@ namespace
             
             auto dst_view = img::sub_view(dst, dst_rect);
 
-            img::transform(char_view, dst_view, to_render_color);            
+            render_mask(char_view, dst_view, dirty);            
 
             dst_rect.x_begin = dst_rect.x_end;
         }
@@ -694,11 +694,40 @@ namespace app
 
         SoundState sounds;
         MusicState music;        
+
+        // loads the sounds and music while the app runs
+        std::thread loader;
+
+        // set by the loader once every asset is resident, sounds and music do nothing until then
+        std::atomic<b32> is_ready;
+
+        // set when the app closes, the loader stops before its next decode
+        std::atomic<b32> is_cancelled;
+
+        // the song as the commands left it, the device follows once ready
+        // the ui shows this so it does not depend on when the loader finishes
+        b8 song_on[MusicState::count];
+        b8 song_paused[MusicState::count];
+
+        // the music streams from its file while it plays, freed after it
+        u8* music_files[MusicState::count];
     };
 
 
+    inline bool is_audio_ready(AudioState const& audio)
+    {
+        return audio.is_ready.load(std::memory_order_acquire);
+    }
+
+
     void destroy_audio_state(AudioState& audio)
     {
+        if (audio.loader.joinable())
+        {
+            audio.is_cancelled.store(true, std::memory_order_relaxed);
+            audio.loader.join();
+        }
+
         for (u32 i = 0; i < audio.sounds.count; i++)
         {
             audio::destroy_sound(audio.sounds.list[i]);
@@ -707,6 +736,9 @@ namespace app
         for (u32 i = 0; i < audio.music.count; i++)
         {
             audio::destroy_music(audio.music.list[i]);
+
+            std::free(audio.music_files[i]);
+            audio.music_files[i] = nullptr;
         }
     }
 
@@ -722,6 +754,7 @@ namespace app
         UIController controller_filter;
         AsciiFilter ascii_filter;
 
+        // in scratch, valid during render
         sv::StringView mouse_coords;
         
         SubView screen_keyboard;
@@ -731,21 +764,45 @@ namespace app
         SubView screen_mouse_coords;
         SubView screen_play_pause;
 
+        // screen memory the sub views point into
+        ImageView ui_screen;
+
         AudioState audio;
 
+        // latest simulated step
+        UIState ui_state;
+
+        // what each panel showed when it was last drawn
+        UIState rendered;
+
         b32 is_init;
-        MemoryBuffer<u8> u8_data;
+
+        // reset at the start of each simulate and render
+        Arena scratch;
+
+        // the app's only allocation, this StateData is at its start
+        // app lifetime memory is pushed here, it commits pages as it grows
+        Arena memory;
     };
 
 
+    // address space for StateData::memory, only the pages pushed to are backed
+    constexpr u32 APP_MEMORY_RESERVE = 64 * 1024 * 1024;
+
+
     static bool create_state_data(AppState& state)
     {
-        auto data = (StateData*)std::malloc(sizeof(StateData));
-        if (!data)
+        Arena memory{};
+        if (!mb::reserve_buffer(memory, APP_MEMORY_RESERVE))
         {
             return false;
         }
 
+        auto data = new (mb::push<StateData>(memory, 1)) StateData();
+
+        data->scratch = mb::push_sub_arena(memory, config::FRAME_SCRATCH_BYTES);
+        data->memory = memory;
+
         state.data_ = data;
 
         return true;
@@ -754,13 +811,20 @@ namespace app
 
     static void destroy_state_data(AppState& state)
     {
+        if (!state.data_)
+        {
+            return;
+        }
+
         auto& state_data = *state.data_;
 
         destroy_audio_state(state_data.audio);
-        
-        mb::destroy_buffer(state_data.u8_data);
 
-        std::free(state.data_);
+        // the state is freed with its own memory
+        auto memory = state_data.memory;
+        mb::destroy_buffer(memory);
+
+        state.data_ = nullptr;
     }
 }
 
@@ -769,211 +833,561 @@ namespace app
 
 namespace
 {
-    void init_keyboard_filter(UIKeyboardFilter& filter, Image const& raw_keyboard, Buffer8& buffer)
-    {
-        auto const width = raw_keyboard.width;
-        auto const height = raw_keyboard.height;
+    constexpr u32 ASCII_SCALE = 1;
 
-        filter.filter = img::make_view(width, height, buffer);
-        img::transform(img::make_view(raw_keyboard), filter.filter, to_filter_color_id);
+    constexpr u32 MOUSE_COORD_CAPACITY = sizeof("(0000, 0000)");
 
-        make_keyboard_filter(filter);
-    }
 
+    // address space for decoding one image, only the pages stb_image touches are backed
+    constexpr u32 DECODE_MEMORY_RESERVE = 256 * 1024 * 1024;
 
-    void init_mouse_filter(UIMouseFilter& filter, Image const& raw_mouse, Buffer8& buffer)
-    {
-        auto const width = raw_mouse.width;
-        auto const height = raw_mouse.height;
 
-        filter.filter = img::make_view(width, height, buffer);
-        img::transform(img::make_view(raw_mouse), filter.filter, to_filter_color_id);
+    // in asset_pack mask order
+    fs::path const* const IMAGE_PATHS[asset_pack::N_MASKS] = { &KEYBOARD_IMAGE_PATH, &MOUSE_IMAGE_PATH, &CONTROLLER_IMAGE_PATH, &ASCII_IMAGE_PATH };
+    constexpr u32 IMAGE_SCALES[asset_pack::N_MASKS] = { 1, 1, 1, ASCII_SCALE };
 
-        make_mouse_filter(filter);
-    }
+    cstr const IMAGE_DECODE_PHASES[asset_pack::N_MASKS] = { "decode keyboard.png", "decode mouse.png", "decode controller.png", "decode ascii.png" };
 
 
-    void init_controller_filter(UIController& filter, Image const& raw_controller, Buffer8& buffer)
+    // pushes each mask on the state memory, the images are decoded into them afterwards
+    bool make_filter_masks(app::StateData& state_data, GrayView* (&masks)[asset_pack::N_MASKS])
     {
-        auto const width = raw_controller.width;
-        auto const height = raw_controller.height;
+        masks[asset_pack::KEYBOARD_MASK] = &state_data.keyboard_filter.filter;
+        masks[asset_pack::MOUSE_MASK] = &state_data.mouse_filter.filter;
+        masks[asset_pack::CONTROLLER_MASK] = &state_data.controller_filter.filter;
+        masks[asset_pack::ASCII_MASK] = &state_data.ascii_filter.filter;
 
-        filter.filter = img::make_view(width, height, buffer);
-        img::transform(img::make_view(raw_controller), filter.filter, to_filter_color_id);
+        for (u32 i = 0; i < asset_pack::N_MASKS; i++)
+        {
+            auto const path = IMAGE_PATHS[i]->string();
 
-        make_controller_filter(filter);
-    }
+            u32 width = 0;
+            u32 height = 0;
 
+            if (!img::read_image_size(path.c_str(), width, height))
+            {
+                printf("Error: read_image_size(%s)\n", path.c_str());
+                return false;
+            }
 
-    void init_ascii_filter(AsciiFilter& filter, Image const& raw_ascii, u32 scale, Buffer8& buffer)
-    {
-        auto const width = raw_ascii.width * scale;
-        auto const height = raw_ascii.height * scale;
+            auto const scale = IMAGE_SCALES[i];
 
-        filter.filter = img::make_view(width, height, buffer);
-        img::transform_scale_up(img::make_view(raw_ascii), filter.filter, scale, to_filter_color_id);
+            *masks[i] = img::make_view(width * scale, height * scale, state_data.memory);
+            if (!masks[i]->matrix_data_)
+            {
+                printf("Error: make_view()\n");
+                return false;
+            }
+        }
 
-        make_ascii_filter(filter, scale);
+        return true;
     }
 
 
-    bool init_screen_filters(app::AppState& state)
+    // runs on a pool task, the decode arena is this task's own
+    bool decode_filter_mask(u32 id, GrayView const& mask, u32& decode_peak)
     {
-        Image raw_keyboard;
-        Image raw_mouse;
-        Image raw_controller;
-        Image raw_ascii;
+        auto const begin_ns = startup_timer::now_ns();
 
-        auto const cleanup = [&]()
-        {
-            img::destroy_image(raw_keyboard);
-            img::destroy_image(raw_mouse);
-            img::destroy_image(raw_controller);
-            img::destroy_image(raw_ascii);
-        };
+        // every stb_image temporary for this image, released when it is in the mask
+        Arena decode_memory{};
 
-        if (!load_keyboard_image(raw_keyboard))
+        if (!mb::reserve_buffer(decode_memory, DECODE_MEMORY_RESERVE))
         {
-            printf("Error: load_keyboard_image()\n");
-            cleanup();
+            printf("Error: reserve_buffer()\n");
             return false;
         }
-        
-        if (!load_mouse_image(raw_mouse))
+
+        auto const path = IMAGE_PATHS[id]->string();
+
+        img::begin_decode(decode_memory);
+        auto const ok = img::read_image_then_transform(path.c_str(), IMAGE_SCALES[id], to_filter_color_id, mask);
+        decode_peak = img::end_decode();
+
+        mb::destroy_buffer(decode_memory);
+
+        startup_timer::record_phase(IMAGE_DECODE_PHASES[id], begin_ns, startup_timer::now_ns(), decode_peak);
+
+        return ok;
+    }
+
+
+    // the images are decoded at once on their own tasks
+    // decode_peak adds up the peak of every image, the most stb_image holds when they all overlap
+    // it is also recorded on the image decode startup phase, app.cpp prints nothing in release
+    bool decode_screen_filters(app::StateData& state_data, u32& decode_peak)
+    {
+        auto const begin_ns = startup_timer::now_ns();
+
+        constexpr auto n_images = asset_pack::N_MASKS;
+
+        GrayView* masks[n_images] = { 0 };
+
+        if (!make_filter_masks(state_data, masks))
         {
-            printf("Error: load_mouse_image()\n");
-            cleanup();
             return false;
         }
 
-        if (!load_controller_image(raw_controller))
+        b8 decode_ok[n_images] = { 0 };
+        u32 decode_peaks[n_images] = { 0 };
+
+        auto const n_threads = std::thread::hardware_concurrency();
+        auto const n_workers = std::min(n_threads > 1 ? n_threads - 1 : 0, n_images - 1);
+
+        // without workers execute runs every task on this thread
+        thread_pool::ThreadPool pool{};
+        thread_pool::create_pool(pool, n_workers);
+
+        thread_pool::execute(pool, n_images, [&](u32 id){ decode_ok[id] = decode_filter_mask(id, *masks[id], decode_peaks[id]); });
+
+        thread_pool::destroy_pool(pool);
+
+        decode_peak = 0;
+        auto filters_ok = true;
+
+        for (u32 i = 0; i < n_images; i++)
         {
-            printf("Error: load_controller_image()\n");
-            cleanup();
-            return false;
+            decode_peak += decode_peaks[i];
+
+            if (!decode_ok[i])
+            {
+                printf("Error: decode %s\n", IMAGE_PATHS[i]->string().c_str());
+                filters_ok = false;
+            }
         }
 
-        if (!load_ascii_image(raw_ascii))
+        startup_timer::record_phase("image decode", begin_ns, startup_timer::now_ns(), decode_peak);
+
+        if (!filters_ok)
         {
-            printf("Error: load_ascii_image()\n");
-            cleanup();
             return false;
         }
-        
-        auto const keyboard_width = raw_keyboard.width;
-        auto const keyboard_height = raw_keyboard.height;
-        
-        auto const mouse_width = raw_mouse.width;
-        auto const mouse_height = raw_mouse.height;
 
-        auto const controller_width = raw_controller.width;
-        auto const controller_height = raw_controller.height;
+        make_keyboard_filter(state_data.keyboard_filter);
+        make_mouse_filter(state_data.mouse_filter);
+        make_controller_filter(state_data.controller_filter);
+        make_ascii_filter(state_data.ascii_filter, ASCII_SCALE);
+        fill_ascii_filter(state_data.ascii_filter);
 
-        constexpr u32 ASCII_SCALE = 1;
+        return true;
+    }
 
-        auto const ascii_width = raw_ascii.width * ASCII_SCALE;
-        auto const ascii_height = raw_ascii.height * ASCII_SCALE;
 
-        u32 screen_width = std::max(keyboard_width, controller_width + mouse_width);
-        u32 screen_height = keyboard_height + std::max(mouse_height, controller_height);
+    // bake_assets compiles this file to write the pack, a stale pack must not stop it
+#ifndef BAKE_ASSETS
 
-        constexpr u32 mouse_coord_capacity = sizeof("(0000, 0000)");
+    // the embedded pack was baked with the sub views this build makes
 
-        auto& state_data = *state.data_;
+    constexpr u32 read_pack_u32(u64 offset)
+    {
+        return asset_pack::read_u32(asset_pack::EMBEDDED_PACK, offset);
+    }
 
-        auto const buffer_bytes = screen_width * screen_height + ascii_width * ascii_height + mouse_coord_capacity;
 
-        auto& u8_buffer = state_data.u8_data;
-        u8_buffer = img::create_buffer8(buffer_bytes);   
+    constexpr u32 read_pack_mask(u32 id, u64 field_offset)
+    {
+        return read_pack_u32(asset_pack::mask_field_offset(id, field_offset));
+    }
 
-        init_keyboard_filter(state_data.keyboard_filter, raw_keyboard, u8_buffer);
-        init_mouse_filter(state_data.mouse_filter, raw_mouse, u8_buffer);
-        init_controller_filter(state_data.controller_filter, raw_controller, u8_buffer);
-        init_ascii_filter(state_data.ascii_filter, raw_ascii, ASCII_SCALE, u8_buffer);
-        state_data.mouse_coords = sv::make_view(mouse_coord_capacity, u8_buffer);
 
-        auto& screen = state.screen;
+    constexpr bool has_pack_rect(u64 offset, Rect2Du32 const& rect)
+    {
+        return
+            read_pack_u32(offset + offsetof(Rect2Du32, x_begin)) == rect.x_begin &&
+            read_pack_u32(offset + offsetof(Rect2Du32, x_end)) == rect.x_end &&
+            read_pack_u32(offset + offsetof(Rect2Du32, y_begin)) == rect.y_begin &&
+            read_pack_u32(offset + offsetof(Rect2Du32, y_end)) == rect.y_end;
+    }
 
-        screen.width = screen_width;
-        screen.height = screen_height;        
 
-        state_data.background_color = GRAY;
+    constexpr bool has_pack_rects(u32 id, Rect2Du32 const* rects, u32 n_rects)
+    {
+        using PackMask = asset_pack::PackMask;
+
+        if (read_pack_mask(id, offsetof(PackMask, n_rects)) != n_rects)
+        {
+            return false;
+        }
 
-        cleanup();
+        u64 offset = read_pack_mask(id, offsetof(PackMask, rects_offset));
+
+        for (u32 i = 0; i < n_rects; i++)
+        {
+            if (!has_pack_rect(offset + i * sizeof(Rect2Du32), rects[i]))
+            {
+                return false;
+            }
+        }
 
         return true;
     }
 
 
-    bool init_audio(app::AudioState& audio)
+    // make_ascii_filter on the mask in the pack
+    constexpr bool has_pack_glyphs(u32 scale)
     {
-        if (!audio::init_audio())
+        using PackMask = asset_pack::PackMask;
+
+        constexpr auto id = asset_pack::ASCII_MASK;
+        constexpr auto count = AsciiFilter::count;
+
+        if (read_pack_mask(id, offsetof(PackMask, n_rects)) != count)
         {
             return false;
         }
 
-        audio.master_volume = 0.5f;
+        auto const height = read_pack_mask(id, offsetof(PackMask, height));
 
-        auto& sounds = audio.sounds;
+        u64 offset = read_pack_mask(id, offsetof(PackMask, rects_offset));
 
-        if (!load_laser_sound(sounds.laser))
+        u32 x = 0;
+        for (u32 i = 0; i < count; i++)
         {
-            return false;
-        }
+            auto width = ASCII_WIDTHS[i] * scale;
+            if (!has_pack_rect(offset + i * sizeof(Rect2Du32), to_rect(x, 0, width, height)))
+            {
+                return false;
+            }
 
-        if (!load_retro_sound(sounds.retro))
-        {
-            return false;
+            x += width;
         }
 
-        if (!load_door_sound(sounds.door))
-        {
-            return false;
-        }
+        return true;
+    }
 
-        if (!load_force_field_sound(sounds.force_field))
-        {
-            return false;
-        }
 
-        auto& music = audio.music;
+    static_assert(read_pack_u32(offsetof(asset_pack::PackHeader, magic)) == asset_pack::PACK_MAGIC, "embedded asset pack is not a pack");
+    static_assert(read_pack_u32(offsetof(asset_pack::PackHeader, version)) == asset_pack::PACK_VERSION, "embedded asset pack is stale, make bake_assets");
+    static_assert(read_pack_u32(offsetof(asset_pack::PackHeader, n_masks)) == asset_pack::N_MASKS, "embedded asset pack is stale, make bake_assets");
+    static_assert(read_pack_u32(offsetof(asset_pack::PackHeader, n_bytes)) == asset_pack::EMBEDDED_BYTES, "embedded asset pack is truncated, make bake_assets");
+
+    static_assert(has_pack_rects(asset_pack::KEYBOARD_MASK, KEYBOARD_RECTS, UIKeyboardFilter::count), "keyboard rects changed, make bake_assets");
+    static_assert(has_pack_rects(asset_pack::MOUSE_MASK, MOUSE_RECTS, UIMouseFilter::count), "mouse rects changed, make bake_assets");
+    static_assert(has_pack_rects(asset_pack::CONTROLLER_MASK, CONTROLLER_RECTS, UIController::count), "controller rects changed, make bake_assets");
+    static_assert(has_pack_glyphs(ASCII_SCALE), "ascii widths changed, make bake_assets");
+
+#endif
+
+
+    // makes the filters from the pack compiled into the program, the images in assets are only read by bake_assets
+    bool copy_screen_filters(app::StateData& state_data)
+    {
+        namespace ap = asset_pack;
 
-        if (!load_mellow_music(music.song))
+        auto const pack = ap::EMBEDDED_PACK;
+
+        if (!ap::is_valid(pack, ap::EMBEDDED_BYTES))
         {
+            printf("embedded asset pack is not valid, make bake_assets\n");
             return false;
         }
-        
 
-        for (u32 i = 0; i < sounds.count; i++)
-        {
-            sounds.list[i].is_on = false;
-        }
+        auto& u8_buffer = state_data.memory;
 
-        for (u32 i = 0; i < music.count; i++)
+        auto& keyboard = state_data.keyboard_filter;
+        auto& mouse = state_data.mouse_filter;
+        auto& controller = state_data.controller_filter;
+        auto& ascii = state_data.ascii_filter;
+
+        keyboard.filter = ap::copy_mask(pack, ap::KEYBOARD_MASK, u8_buffer);
+        mouse.filter = ap::copy_mask(pack, ap::MOUSE_MASK, u8_buffer);
+        controller.filter = ap::copy_mask(pack, ap::CONTROLLER_MASK, u8_buffer);
+        ascii.filter = ap::copy_mask(pack, ap::ASCII_MASK, u8_buffer);
+
+        if (!keyboard.filter.matrix_data_ || !mouse.filter.matrix_data_ || !controller.filter.matrix_data_ || !ascii.filter.matrix_data_)
         {
-            music.list[i].is_on = false;
+            printf("Error: copy_mask()\n");
+            return false;
         }
 
+        make_keyboard_filter(keyboard);
+        make_mouse_filter(mouse);
+        make_controller_filter(controller);
+        make_ascii_filter(ascii, ASCII_SCALE);
+
         return true;
     }
 
 
-    void init_screen_ui(app::AppState& state)
+    bool write_screen_filters(app::StateData const& state_data, cstr source_path)
     {
-        auto& state_data = *state.data_;
-        auto& screen = state.screen;
+        namespace ap = asset_pack;
 
-        auto keyboard = to_rect(0, 0, state_data.keyboard_filter.filter.width, state_data.keyboard_filter.filter.height);
+        auto const& keyboard = state_data.keyboard_filter;
+        auto const& mouse = state_data.mouse_filter;
+        auto const& controller = state_data.controller_filter;
+        auto const& ascii = state_data.ascii_filter;
 
-        auto controller = to_rect(0, keyboard.y_end, state_data.controller_filter.filter.width, state_data.controller_filter.filter.height);
-        
-        auto mouse = to_rect(controller.x_end, controller.y_begin, state_data.mouse_filter.filter.width, state_data.mouse_filter.filter.height);
-        
-        state_data.screen_keyboard = img::sub_view(screen, keyboard);
-        state_data.screen_mouse = img::sub_view(screen, mouse);
-        state_data.screen_controller = img::sub_view(screen, controller);
+        ap::MaskSource sources[ap::N_MASKS];
 
-        auto const text_height = state_data.ascii_filter.filter.height;
+        sources[ap::KEYBOARD_MASK] = { keyboard.filter, keyboard.keys, keyboard.count };
+        sources[ap::MOUSE_MASK] = { mouse.filter, mouse.buttons, mouse.count };
+        sources[ap::CONTROLLER_MASK] = { controller.filter, controller.buttons, controller.count };
+        sources[ap::ASCII_MASK] = { ascii.filter, ascii.characters, ascii.count };
+
+        return ap::write_pack_source(source_path, sources);
+    }
+
+
+    void init_screen(app::AppState& state)
+    {
+        auto& state_data = *state.data_;
+
+        auto const& keyboard = state_data.keyboard_filter.filter;
+        auto const& mouse = state_data.mouse_filter.filter;
+        auto const& controller = state_data.controller_filter.filter;
+
+        u32 screen_width = std::max(keyboard.width, controller.width + mouse.width);
+        u32 screen_height = keyboard.height + std::max(mouse.height, controller.height);
+
+        auto& screen = state.screen;
+
+        screen.width = screen_width;
+        screen.height = screen_height;
+        screen.matrix_width = screen_width;
+
+        state_data.background_color = GRAY;
+    }
+
+
+    // in SoundState and MusicState order
+    fs::path const* const SOUND_PATHS[SoundState::count] = { &LASER_SOUND_PATH, &RETRO_SOUND_PATH, &DOOR_SOUND_PATH, &FORCE_FIELD_SOUND_PATH };
+    fs::path const* const MUSIC_PATHS[MusicState::count] = { &MELLOW_MUSIC_PATH };
+
+    cstr const SOUND_FILES[SoundState::count] = { LASER_SOUND_FILE, RETRO_SOUND_FILE, DOOR_SOUND_FILE, FORCE_FIELD_SOUND_FILE };
+    cstr const MUSIC_FILES[MusicState::count] = { MELLOW_MUSIC_FILE };
+
+    // startup phase names, the read phases are the file names
+    cstr const SOUND_DECODE_PHASES[SoundState::count] = { "decode laserLarge_000.ogg", "decode laserRetro_003.ogg", "decode doorOpen_000.ogg", "decode forceField_000.ogg" };
+    cstr const MUSIC_DECODE_PHASES[MusicState::count] = { "decode mellow-future-bass-bounce-on-it-184234.mp3" };
+
+    constexpr u32 N_AUDIO_ASSETS = SoundState::count + MusicState::count;
+
+
+    class AssetLoad
+    {
+    public:
+        cstr name = nullptr;
+
+        // the whole file, std::free it
+        u8* bytes = nullptr;
+        u32 n_bytes = 0;
+
+        b32 ok = 0;
+    };
+
+
+    static u8* read_file(fs::path const& path, u32& n_bytes)
+    {
+        auto file = fopen(path.string().c_str(), "rb");
+        if (!file)
+        {
+            return nullptr;
+        }
+
+        fseek(file, 0, SEEK_END);
+        auto const size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        auto bytes = size > 0 ? (u8*)std::malloc((size_t)size) : nullptr;
+        if (!bytes)
+        {
+            fclose(file);
+            return nullptr;
+        }
+
+        auto const n_read = fread(bytes, 1, (size_t)size, file);
+        fclose(file);
+
+        if (n_read != (size_t)size)
+        {
+            std::free(bytes);
+            return nullptr;
+        }
+
+        n_bytes = (u32)size;
+
+        return bytes;
+    }
+
+
+    // each read is a startup phase named for its file
+    static void read_audio_file(u32 id, AssetLoad& load)
+    {
+        auto const is_sound = id < SoundState::count;
+        auto const& path = is_sound ? *SOUND_PATHS[id] : *MUSIC_PATHS[id - SoundState::count];
+
+        load.name = is_sound ? SOUND_FILES[id] : MUSIC_FILES[id - SoundState::count];
+
+        auto const begin_ns = startup_timer::now_ns();
+
+        load.bytes = read_file(path, load.n_bytes);
+
+        startup_timer::record_phase(load.name, begin_ns, startup_timer::now_ns());
+    }
+
+
+    // SDL_mixer does not promise its loads are thread safe, they run one at a time on this thread
+    static void decode_audio_file(app::AudioState& audio, u32 id, AssetLoad& load)
+    {
+        if (!load.bytes)
+        {
+            return;
+        }
+
+        if (id < SoundState::count)
+        {
+            // a chunk is decoded whole, the file is not needed after
+            {
+                STARTUP_PHASE(SOUND_DECODE_PHASES[id]);
+                load.ok = audio::load_sound_from_memory(load.bytes, load.n_bytes, audio.sounds.list[id]);
+            }
+
+            std::free(load.bytes);
+            load.bytes = nullptr;
+
+            return;
+        }
+
+        auto const music_id = id - SoundState::count;
+
+        {
+            STARTUP_PHASE(MUSIC_DECODE_PHASES[music_id]);
+            load.ok = audio::load_music_from_memory(load.bytes, load.n_bytes, audio.music.list[music_id]);
+        }
+        if (load.ok)
+        {
+            audio.music_files[music_id] = load.bytes;
+        }
+        else
+        {
+            std::free(load.bytes);
+        }
+
+        load.bytes = nullptr;
+    }
+
+
+    // the files are read on their own tasks, then decoded in order
+    // all of them are attempted and every failure is reported
+    bool load_audio_assets(app::AudioState& audio)
+    {
+        STARTUP_PHASE("audio assets");
+
+        AssetLoad loads[N_AUDIO_ASSETS];
+
+        auto const n_threads = std::thread::hardware_concurrency();
+        auto const n_workers = std::min(n_threads > 1 ? n_threads - 1 : 0, N_AUDIO_ASSETS - 1);
+
+        // without workers execute runs every task on this thread
+        thread_pool::ThreadPool pool{};
+        thread_pool::create_pool(pool, n_workers);
+
+        thread_pool::execute(pool, N_AUDIO_ASSETS, [&](u32 id){ read_audio_file(id, loads[id]); });
+
+        thread_pool::destroy_pool(pool);
+
+        {
+            STARTUP_PHASE("audio decode");
+
+            for (u32 id = 0; id < N_AUDIO_ASSETS; id++)
+            {
+                if (audio.is_cancelled.load(std::memory_order_relaxed))
+                {
+                    // closing does not wait for the files left
+                    std::free(loads[id].bytes);
+                    loads[id].bytes = nullptr;
+                    continue;
+                }
+
+                decode_audio_file(audio, id, loads[id]);
+            }
+        }
+
+        if (audio.is_cancelled.load(std::memory_order_relaxed))
+        {
+            return false;
+        }
+
+        u32 n_failed = 0;
+
+        for (auto const& load : loads)
+        {
+            if (!load.ok)
+            {
+                fprintf(stderr, "Error: load %s\n", load.name);
+                ++n_failed;
+            }
+        }
+
+        if (n_failed)
+        {
+            fprintf(stderr, "Error: %u of %u audio assets failed to load, the app runs without sound\n", n_failed, N_AUDIO_ASSETS);
+        }
+
+        return n_failed == 0;
+    }
+
+
+    static void load_audio_proc(app::AudioState& audio)
+    {
+        if (!load_audio_assets(audio))
+        {
+            // the app runs on without sound
+            return;
+        }
+
+        auto& sounds = audio.sounds;
+        auto& music = audio.music;
+
+        for (u32 i = 0; i < sounds.count; i++)
+        {
+            sounds.list[i].is_on = false;
+        }
+
+        for (u32 i = 0; i < music.count; i++)
+        {
+            music.list[i].is_on = false;
+        }
+
+        audio.is_ready.store(true, std::memory_order_release);
+    }
+
+
+    // opens the device, the assets load in the background so the first frame does not wait on them
+    bool init_audio(app::AudioState& audio)
+    {
+        if (!audio::init_audio())
+        {
+            return false;
+        }
+
+        audio.master_volume = 0.5f;
+        audio.is_ready = false;
+        audio.is_cancelled = false;
+
+        audio.loader = std::thread(load_audio_proc, std::ref(audio));
+
+        return true;
+    }
+
+
+    void init_screen_ui(app::AppState& state)
+    {
+        auto& state_data = *state.data_;
+        auto& screen = state.screen;
+
+        auto keyboard = to_rect(0, 0, state_data.keyboard_filter.filter.width, state_data.keyboard_filter.filter.height);
+
+        auto controller = to_rect(0, keyboard.y_end, state_data.controller_filter.filter.width, state_data.controller_filter.filter.height);
+        
+        auto mouse = to_rect(controller.x_end, controller.y_begin, state_data.mouse_filter.filter.width, state_data.mouse_filter.filter.height);
+        
+        state_data.screen_keyboard = img::sub_view(screen, keyboard);
+        state_data.screen_mouse = img::sub_view(screen, mouse);
+        state_data.screen_controller = img::sub_view(screen, controller);
+
+        auto const text_height = state_data.ascii_filter.filter.height;
 
         auto const mouse_width = state_data.screen_mouse.width;
         auto const mouse_height = state_data.screen_mouse.height;
@@ -997,6 +1411,17 @@ namespace
         auto spacebar_view = img::sub_view(state_data.screen_keyboard, spacebar_filter.range);
         auto const play_pause_rect = to_rect(play_pause_x, play_pause_y, play_pause_width, text_height);
         state_data.screen_play_pause = img::sub_view(spacebar_view, play_pause_rect);
+
+        state_data.ui_screen = screen;
+    }
+
+
+    static bool has_screen_moved(app::AppState const& state)
+    {
+        auto& screen = state.screen;
+        auto& ui_screen = state.data_->ui_screen;
+
+        return screen.matrix_data_ != ui_screen.matrix_data_ || screen.matrix_width != ui_screen.matrix_width;
     }
 
 }
@@ -1128,10 +1553,44 @@ namespace
     }
 
 
-    void read_ui_mouse_coords(input::Input const& input, sv::StringView& coords)
+    [[noreturn]] void scratch_overflow(app::StateData const& state)
     {
-        auto mouse_pos = input.mouse.window_pos;
+        printf("Error: frame scratch over budget, %u bytes\n", state.scratch.capacity_);
+
+        assert(false && "frame scratch over budget");
+        std::abort();
+    }
 
+
+    template <typename T>
+    T* push_scratch(app::StateData& state, u32 count)
+    {
+        auto data = mb::push<T>(state.scratch, count);
+        if (!data)
+        {
+            scratch_overflow(state);
+        }
+
+        return data;
+    }
+
+
+    void begin_scratch(app::StateData& state)
+    {
+        mb::reset_buffer(state.scratch);
+    }
+
+
+    void end_scratch(app::AppState& state)
+    {
+        auto const size = state.data_->scratch.size_;
+
+        state.scratch_high_water = std::max(state.scratch_high_water, size);
+    }
+
+
+    void write_mouse_coords(Point2Di32 mouse_pos, sv::StringView& coords)
+    {
         sv::zero_view(coords);
 
         qsnprintf(coords.data_, coords.capacity, "(%d, %d)", mouse_pos.x, mouse_pos.y);
@@ -1146,12 +1605,67 @@ namespace
 
 namespace
 {
-    void render_keyboard(AppCommand const& command, app::StateData const& state)
+    static bool is_song_playing(app::StateData const& state)
     {
+        auto& audio = state.audio;
+
+        return audio.song_on[0] && !audio.song_paused[0];
+    }
+
+
+    template <class CMD>
+    static bool has_changed(CMD const& current, CMD& previous)
+    {
+        if (std::memcmp(&current, &previous, sizeof(CMD)) == 0)
+        {
+            return false;
+        }
+
+        previous = current;
+        return true;
+    }
+
+
+    void mark_ui_dirty(UIState const& ui, app::StateData& state, img::DirtyRects& dirty)
+    {
+        auto& rendered = state.rendered;
+
+        auto keyboard = has_changed(ui.command.keyboard, rendered.command.keyboard);
+        keyboard |= has_changed(ui.song_playing, rendered.song_playing);
+
+        auto mouse = has_changed(ui.command.mouse, rendered.command.mouse);
+        mouse |= has_changed(ui.mouse_pos, rendered.mouse_pos);
+
+        auto controller = has_changed(ui.command.controller, rendered.command.controller);
+
+        if (keyboard)
+        {
+            img::mark_dirty(dirty, state.screen_keyboard.range);
+        }
+
+        if (mouse)
+        {
+            img::mark_dirty(dirty, state.screen_mouse.range);
+        }
+
+        if (controller)
+        {
+            img::mark_dirty(dirty, state.screen_controller.range);
+        }
+    }
+
+
+    void render_keyboard(UIState const& ui_state, app::StateData const& state, img::DirtyRects const& dirty)
+    {
+        if (!img::is_dirty(dirty, state.screen_keyboard.range))
+        {
+            return;
+        }
+
         constexpr auto key_on = to_u8(ColorId::LightBlue);
         constexpr auto key_off = to_u8(ColorId::Blue);
 
-        auto& cmd = command.ui.keyboard;
+        auto& cmd = ui_state.command.keyboard;
         auto& ui = state.keyboard_filter;
         static_assert(cmd.count == ui.count);
 
@@ -1161,23 +1675,25 @@ namespace
             img::fill_if(ui.keys[i], color_id, can_set_color_id);
         }
 
-        img::transform(ui.filter, state.screen_keyboard, to_render_color);
-
+        render_mask(ui.filter, state.screen_keyboard, dirty);
 
-        auto& song = state.audio.music.song;
+        cstr text = ui_state.song_playing ? "pause" : "play";
 
-        cstr text = (!song.is_on || song.is_paused) ? "play" : "pause";
-
-        write_to_view(state.ascii_filter, sv::to_string_view(text), state.screen_play_pause);
+        write_to_view(state.ascii_filter, sv::to_string_view(text), state.screen_play_pause, dirty);
     }
 
 
-    void render_mouse(AppCommand const& command, app::StateData const& state)
+    void render_mouse(UIState const& ui_state, app::StateData const& state, img::DirtyRects const& dirty)
     {
+        if (!img::is_dirty(dirty, state.screen_mouse.range))
+        {
+            return;
+        }
+
         constexpr auto key_on = to_u8(ColorId::LightBlue);
         constexpr auto key_off = to_u8(ColorId::Blue);
 
-        auto& cmd = command.ui.mouse;
+        auto& cmd = ui_state.command.mouse;
         auto& ui = state.mouse_filter;
         static_assert(cmd.count == ui.count);
 
@@ -1187,18 +1703,23 @@ namespace
             img::fill_if(ui.buttons[i], color_id, can_set_color_id);
         }
 
-        img::transform(ui.filter, state.screen_mouse, to_render_color);
+        render_mask(ui.filter, state.screen_mouse, dirty);
         
-        write_to_view(state.ascii_filter, state.mouse_coords, state.screen_mouse_coords);
+        write_to_view(state.ascii_filter, state.mouse_coords, state.screen_mouse_coords, dirty);
     }
 
 
-    void render_controller(AppCommand const& command, app::StateData const& state)
+    void render_controller(UIState const& ui_state, app::StateData const& state, img::DirtyRects const& dirty)
     {
+        if (!img::is_dirty(dirty, state.screen_controller.range))
+        {
+            return;
+        }
+
         constexpr auto key_on = to_u8(ColorId::LightBlue);
         constexpr auto key_off = to_u8(ColorId::Blue);
 
-        auto& cmd = command.ui.controller;
+        auto& cmd = ui_state.command.controller;
         auto& ui = state.controller_filter;
         static_assert(cmd.count == ui.count);
 
@@ -1208,7 +1729,7 @@ namespace
             img::fill_if(ui.buttons[i], color_id, can_set_color_id);
         }
 
-        img::transform(ui.filter, state.screen_controller, to_render_color);
+        render_mask(ui.filter, state.screen_controller, dirty);
     }    
 
 
@@ -1237,11 +1758,17 @@ namespace
         auto& sounds = state.audio.sounds;        
         static_assert(cmd.count == sounds.count);
 
-        auto& music = state.audio.music;
+        // a sound asked for while loading is dropped, it would be late
+        if (!app::is_audio_ready(state.audio))
+        {
+            return;
+        }
+
+        auto& audio = state.audio;
 
-        for (u32 i = 0; i < music.count; i++)
+        for (u32 i = 0; i < audio.music.count; i++)
         {
-            if (music.list[i].is_on && !music.list[i].is_paused)
+            if (audio.song_on[i] && !audio.song_paused[i])
             {
                 return;
             }
@@ -1270,34 +1797,73 @@ namespace
     }
 
 
+    // starts, pauses or resumes the device to match the commands so far
+    static void sync_music(app::AudioState& audio)
+    {
+        auto& music = audio.music;
+
+        for (u32 i = 0; i < music.count; i++)
+        {
+            auto& song = music.list[i];
+            auto const is_playing = audio.song_on[i] && !audio.song_paused[i];
+
+            if (!is_playing)
+            {
+                if (song.is_on && !song.is_paused)
+                {
+                    audio::toggle_pause_music(song);
+                }
+            }
+            else if (!song.is_on)
+            {
+                audio::play_music(song);
+            }
+            else if (song.is_paused)
+            {
+                audio::toggle_pause_music(song);
+            }
+        }
+    }
+
+
+    // the commands always take effect, the device catches up once the music has loaded
+    // a replay draws the same frames however long the live run took to load
     void play_music(AppCommand const& command, app::StateData& state)
     {
         auto& cmd = command.audio.music;
-        auto& music = state.audio.music;
-        static_assert(cmd.count == music.count);
+        auto& audio = state.audio;
+        static_assert(cmd.count == MusicState::count);
 
         for (u32 i = 0; i < cmd.count; i++)
         {
-            if (cmd.play[i])
+            if (!cmd.play[i])
             {
-                if (music.list[i].is_on)
-                {
-                    audio::toggle_pause_music(music.list[i]);
-                }
-                else
-                {
-                    audio::play_music(music.list[i]);
-                }
+                continue;
+            }
+
+            if (audio.song_on[i])
+            {
+                audio.song_paused[i] = !audio.song_paused[i];
+            }
+            else
+            {
+                audio.song_on[i] = 1;
+                audio.song_paused[i] = 0;
             }
         }
+
+        if (app::is_audio_ready(audio))
+        {
+            sync_music(audio);
+        }
     }
 
 
-    void render_ui(AppCommand const& cmd, app::StateData& state)
+    void render_ui(UIState const& ui_state, app::StateData& state, img::DirtyRects const& dirty)
     {        
-        render_keyboard(cmd, state);
-        render_mouse(cmd, state);
-        render_controller(cmd, state);
+        render_keyboard(ui_state, state, dirty);
+        render_mouse(ui_state, state, dirty);
+        render_controller(ui_state, state, dirty);
     }
 
 
@@ -1323,14 +1889,22 @@ namespace app
             return false;
         }
 
-        if (!init_screen_filters(state))
+        auto& state_data = *state.data_;
+
+        auto const filters_ok = [&]()
         {
-            printf("Error: create_state_data()\n");
+            STARTUP_PHASE("ui filters");
+            return copy_screen_filters(state_data);
+        }();
+
+        if (!filters_ok)
+        {
+            printf("Error: copy_screen_filters()\n");
             close(state);
             return false;
         }
 
-        auto& state_data = *state.data_;
+        init_screen(state);
 
         if (!init_audio(state_data.audio))
         {
@@ -1339,38 +1913,145 @@ namespace app
             return false;
         }
 
+        auto const n_threads = std::thread::hardware_concurrency();
+        auto const n_workers = n_threads > 1 ? n_threads - 1 : 0;
+
+        if (!img::init_parallel(n_workers, config::PARALLEL_MIN_PIXELS))
+        {
+            printf("Error: init_parallel()\n");
+            close(state);
+            return false;
+        }
+
+        state_data.ui_state = {};
         state_data.is_init = false;       
 
         return true;
     }
 
 
-    void update(AppState& state, input::Input const& input)
+    void wait_for_assets(AppState& state)
+    {
+        auto& audio = state.data_->audio;
+
+        if (audio.loader.joinable())
+        {
+            audio.loader.join();
+        }
+    }
+
+
+    void simulate(AppState& state, input::Input const& input)
+    {
+        auto& state_data = *state.data_;
+        auto& ui_state = state_data.ui_state;
+
+        begin_scratch(state_data);
+
+        auto& cmd = *new (push_scratch<AppCommand>(state_data, 1)) AppCommand();
+
+        {
+            PROFILE_ZONE("read_input_commands");
+            read_input_commands(input, cmd);
+        }
+
+        // the ui shows the song state from before this step's commands
+        ui_state.command = cmd.ui;
+        ui_state.mouse_pos = input.mouse.window_pos;
+        ui_state.song_playing = (b8)is_song_playing(state_data);
+
+        {
+            PROFILE_ZONE("update_audio");
+            update_audio(cmd, state_data);
+        }
+
+        end_scratch(state);
+    }
+
+
+    void render(AppState& state, f32 alpha)
     {
         auto& screen = state.screen;
         auto& state_data = *state.data_;
+        auto& ui_state = state_data.ui_state;
+        auto& dirty = state.screen_dirty;
+
+        // nothing in the ui moves between steps, the latest step is drawn as is
+        (void)alpha;
+
+        img::clear_dirty(dirty);
 
         if (!state_data.is_init)
         {
+            STARTUP_PHASE("init_screen_ui");
             init_screen_ui(state);
+            img::mark_dirty(dirty, to_rect(0, 0, screen.width, screen.height));
             state_data.is_init = true;
         }
+        else if (has_screen_moved(state))
+        {
+            // new memory holds the last frame unless screen_stale says otherwise
+            init_screen_ui(state);
+        }
+
+        auto& stale = state.screen_stale;
+        for (u32 i = 0; i < stale.count; i++)
+        {
+            img::mark_dirty(dirty, stale.rects[i]);
+        }
+
+        img::clear_dirty(stale);
+
+        PROFILE_ZONE("render_ui");
+
+        begin_scratch(state_data);
+
+        state_data.mouse_coords = sv::make_view(MOUSE_COORD_CAPACITY, state_data.scratch);
+        if (!state_data.mouse_coords.data_)
+        {
+            scratch_overflow(state_data);
+        }
+
+        write_mouse_coords(ui_state.mouse_pos, state_data.mouse_coords);
 
-        AppCommand cmd{};
+        mark_ui_dirty(ui_state, state_data, dirty);
+        img::fill(screen, state_data.background_color, dirty);
+        render_ui(ui_state, state_data, dirty);
 
-        read_input_commands(input, cmd);
-        read_ui_mouse_coords(input, state_data.mouse_coords);  
+        end_scratch(state);
+    }
 
-        img::fill(screen, state_data.background_color);
 
-        render_ui(cmd, state_data);
-        update_audio(cmd, state_data);
+    void update(AppState& state, input::Input const& input)
+    {
+        simulate(state, input);
+        render(state, 1.0f);
     }
 
 
     void close(AppState& state)
     {
+        img::close_parallel();
         destroy_state_data(state);
         audio::close_audio();
     }
+
+
+    bool write_asset_pack(cstr source_path, u32& decode_peak)
+    {
+        AppState state{};
+        if (!create_state_data(state))
+        {
+            printf("Error: create_state_data()\n");
+            return false;
+        }
+
+        auto& state_data = *state.data_;
+
+        auto const ok = decode_screen_filters(state_data, decode_peak) && write_screen_filters(state_data, source_path);
+
+        destroy_state_data(state);
+
+        return ok;
+    }
 }
\ No newline at end of file
@@ -17,16 +17,42 @@ namespace app
     public:
         ImageView screen;
 
+        // screen regions redrawn by the last update
+        image::DirtyRects screen_dirty;
+
+        // regions of the screen memory that do not hold the last frame
+        // set before a render when the screen changes hands, the render redraws and clears them
+        image::DirtyRects screen_stale;
+
+        // most frame scratch bytes one simulate or render has used
+        u32 scratch_high_water = 0;
+
         StateData* data_ = nullptr;
     };
 
 
     bool init(AppState& state);
 
+    // blocks until the assets init left loading in the background are resident
+    // for benches that must not time the loader, the screen never depends on it
+    void wait_for_assets(AppState& state);
+
+    // advances the app by one step of input.dt_frame seconds
+    void simulate(AppState& state, input::Input const& input);
+
+    // draws the latest step to the screen
+    // alpha is the part of a step that has passed since it, 0 to 1
+    void render(AppState& state, f32 alpha);
+
+    // one step and a render
     void update(AppState& state, input::Input const& input);
 
     void close(AppState& state);
 
+    // decodes the ui images and writes the filters as a header init compiles in
+    // decode_peak is the most memory stb_image held at once
+    bool write_asset_pack(cstr source_path, u32& decode_peak);
+
 }
 
 
@@ -36,6 +62,12 @@ namespace config
 
     constexpr u32 WINDOW_SCALE = 2;
 
+    // image operations on smaller views stay single threaded
+    constexpr u32 PARALLEL_MIN_PIXELS = 512 * 512;
+
+    // temporaries of one simulate or render, more than this stops the app
+    constexpr u32 FRAME_SCRATCH_BYTES = 16 * 1024;
+
 
 #ifdef _WIN32
     constexpr auto ROOT = "C:/D_Data/Repos";
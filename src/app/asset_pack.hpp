@@ -0,0 +1,292 @@
+#pragma once
+
+#include "../output/image.hpp"
+#include "../util/hash.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+
+// ui filter masks as the app uses them, baked offline by bake_assets
+// bake_assets writes the pack as a constexpr array compiled into the app
+// the app copies the masks out of it, nothing is read or decoded
+// the app does not compile when the pack does not match its filters
+// each mask carries the rects of its sub views, the ascii rects are the glyph widths
+
+namespace asset_pack
+{
+    constexpr u32 PACK_MAGIC = 0x50'4C'44'53; // "SDLP"
+    constexpr u32 PACK_VERSION = 2;
+
+    // each mask starts on a cache line for the simd kernels
+    constexpr u32 PACK_ALIGNMENT = 64;
+
+    // mask order in the pack
+    constexpr u32 KEYBOARD_MASK = 0;
+    constexpr u32 MOUSE_MASK = 1;
+    constexpr u32 CONTROLLER_MASK = 2;
+    constexpr u32 ASCII_MASK = 3;
+
+    constexpr u32 N_MASKS = 4;
+
+    constexpr cstr MASK_NAMES[N_MASKS] = { "keyboard", "mouse", "controller", "ascii" };
+
+
+    class PackMask
+    {
+    public:
+        u32 width;
+        u32 height;
+        u32 data_offset;
+
+        u32 n_rects;
+        u32 rects_offset;
+    };
+
+
+    class PackHeader
+    {
+    public:
+        u32 magic;
+        u32 version;
+
+        u32 n_bytes;
+        u32 n_masks;
+
+        // of every byte after the header
+        u64 checksum;
+
+        PackMask masks[N_MASKS];
+    };
+
+
+    // what the baker writes for one mask
+    class MaskSource
+    {
+    public:
+        image::GrayView mask;
+
+        image::GraySubView const* sub_views = nullptr;
+        u32 n_sub_views = 0;
+    };
+
+
+    inline u32 align_offset(u32 offset)
+    {
+        return (offset + PACK_ALIGNMENT - 1) & ~(PACK_ALIGNMENT - 1);
+    }
+
+
+    inline u64 hash_contents(u8 const* pack, u32 n_bytes)
+    {
+        return hash::hash_bytes(pack + sizeof(PackHeader), n_bytes - sizeof(PackHeader));
+    }
+
+
+    // the pack in one allocation, std::free it
+    inline u8* create_pack(MaskSource const (&sources)[N_MASKS], u32& n_bytes)
+    {
+        PackHeader header{};
+        header.magic = PACK_MAGIC;
+        header.version = PACK_VERSION;
+        header.n_masks = N_MASKS;
+
+        u32 offset = sizeof(PackHeader);
+
+        for (u32 i = 0; i < N_MASKS; i++)
+        {
+            auto const& src = sources[i];
+            auto& dst = header.masks[i];
+
+            dst.width = src.mask.width;
+            dst.height = src.mask.height;
+            dst.n_rects = src.n_sub_views;
+
+            dst.rects_offset = offset;
+            offset += src.n_sub_views * (u32)sizeof(Rect2Du32);
+
+            dst.data_offset = align_offset(offset);
+            offset = dst.data_offset + src.mask.width * src.mask.height;
+        }
+
+        header.n_bytes = offset;
+
+        auto pack = (u8*)std::calloc(offset, 1);
+        if (!pack)
+        {
+            return nullptr;
+        }
+
+        for (u32 i = 0; i < N_MASKS; i++)
+        {
+            auto const& src = sources[i];
+            auto const& dst = header.masks[i];
+
+            auto rects = (Rect2Du32*)(pack + dst.rects_offset);
+            for (u32 r = 0; r < src.n_sub_views; r++)
+            {
+                rects[r] = src.sub_views[r].range;
+            }
+
+            auto const& mask = src.mask;
+            for (u32 y = 0; y < mask.height; y++)
+            {
+                std::memcpy(pack + dst.data_offset + y * mask.width, mask.matrix_data_ + (u64)y * mask.matrix_width, mask.width);
+            }
+        }
+
+        header.checksum = hash_contents(pack, header.n_bytes);
+        std::memcpy(pack, &header, sizeof(header));
+
+        n_bytes = header.n_bytes;
+
+        return pack;
+    }
+
+
+    inline void write_bytes(FILE* file, u8 const* bytes, u32 n_bytes)
+    {
+        fprintf(file, "        ");
+
+        for (u32 i = 0; i < n_bytes; i++)
+        {
+            fprintf(file, "%u,", bytes[i]);
+        }
+
+        fprintf(file, "\n");
+    }
+
+
+    // the pack as a c++ header, one line per mask row
+    inline bool write_pack_source(cstr path, MaskSource const (&sources)[N_MASKS])
+    {
+        u32 n_bytes = 0;
+        auto pack = create_pack(sources, n_bytes);
+        if (!pack)
+        {
+            return false;
+        }
+
+        auto file = fopen(path, "w");
+        if (!file)
+        {
+            std::free(pack);
+            return false;
+        }
+
+        auto const& h = *(PackHeader const*)pack;
+
+        fprintf(file, "#pragma once\n\n");
+        fprintf(file, "#include \"../util/types.hpp\"\n\n");
+        fprintf(file, "// generated by bake_assets from the images in assets, do not edit\n");
+        fprintf(file, "// make bake_assets after changing an image or a filter's sub views\n\n");
+        fprintf(file, "namespace asset_pack\n{\n");
+        fprintf(file, "    constexpr u32 EMBEDDED_BYTES = %u;\n\n\n", n_bytes);
+        fprintf(file, "    alignas(%u) constexpr u8 EMBEDDED_PACK[EMBEDDED_BYTES] =\n    {\n", PACK_ALIGNMENT);
+
+        fprintf(file, "        // header\n");
+        write_bytes(file, pack, (u32)sizeof(PackHeader));
+
+        for (u32 i = 0; i < N_MASKS; i++)
+        {
+            auto const& m = h.masks[i];
+
+            fprintf(file, "\n        // %s rects\n", MASK_NAMES[i]);
+            write_bytes(file, pack + m.rects_offset, m.data_offset - m.rects_offset);
+
+            fprintf(file, "\n        // %s mask %ux%u\n", MASK_NAMES[i], m.width, m.height);
+            for (u32 y = 0; y < m.height; y++)
+            {
+                write_bytes(file, pack + m.data_offset + y * m.width, m.width);
+            }
+        }
+
+        fprintf(file, "    };\n}\n");
+
+        auto const ok = !ferror(file);
+
+        std::free(pack);
+
+        return fclose(file) == 0 && ok;
+    }
+
+
+    inline PackHeader const& header(u8 const* pack)
+    {
+        return *(PackHeader const*)pack;
+    }
+
+
+    // reads the pack when the compiler has it as bytes, the baker writes it little endian
+    constexpr u32 read_u32(u8 const* pack, u64 offset)
+    {
+        return (u32)pack[offset] | (u32)pack[offset + 1] << 8 | (u32)pack[offset + 2] << 16 | (u32)pack[offset + 3] << 24;
+    }
+
+
+    // offset of a PackMask field in the header, e.g. offsetof(PackMask, n_rects)
+    constexpr u64 mask_field_offset(u32 id, u64 field_offset)
+    {
+        return offsetof(PackHeader, masks) + id * sizeof(PackMask) + field_offset;
+    }
+
+
+    // a whole pack from this version, every mask inside it and the checksum matching
+    inline bool is_valid(u8 const* pack, u64 n_bytes)
+    {
+        if (!pack || n_bytes < sizeof(PackHeader))
+        {
+            return false;
+        }
+
+        auto const& h = header(pack);
+
+        if (h.magic != PACK_MAGIC || h.version != PACK_VERSION || h.n_masks != N_MASKS || h.n_bytes != n_bytes)
+        {
+            return false;
+        }
+
+        for (u32 i = 0; i < N_MASKS; i++)
+        {
+            auto const& m = h.masks[i];
+
+            auto const rects_end = (u64)m.rects_offset + (u64)m.n_rects * sizeof(Rect2Du32);
+            auto const data_end = (u64)m.data_offset + (u64)m.width * m.height;
+
+            if (m.rects_offset < sizeof(PackHeader) || m.rects_offset % alignof(Rect2Du32) || rects_end > n_bytes)
+            {
+                return false;
+            }
+
+            if (m.data_offset % PACK_ALIGNMENT || data_end > n_bytes || !m.width || !m.height)
+            {
+                return false;
+            }
+        }
+
+        return hash_contents(pack, h.n_bytes) == h.checksum;
+    }
+
+
+    // the app recolors its filters, each mask is copied out of the read only pack
+    inline image::GrayView copy_mask(u8 const* pack, u32 id, image::Buffer8& buffer)
+    {
+        auto const& m = header(pack).masks[id];
+
+        auto view = image::make_view(m.width, m.height, buffer);
+        if (view.matrix_data_)
+        {
+            std::memcpy(view.matrix_data_, pack + m.data_offset, (size_t)m.width * m.height);
+        }
+
+        return view;
+    }
+
+
+    inline Rect2Du32 const* mask_rects(u8 const* pack, u32 id)
+    {
+        return (Rect2Du32 const*)(pack + header(pack).masks[id].rects_offset);
+    }
+}
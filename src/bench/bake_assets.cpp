@@ -0,0 +1,35 @@
+#include "../app/app.hpp"
+#include "../util/startup_timer.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+
+// writes the ui filter pack as the header the app compiles in
+// run again whenever an image in assets or a filter's sub views change
+
+int main(int argc, char* argv[])
+{
+    startup_timer::now_ns();
+
+    if (argc < 2)
+    {
+        printf("usage: bake_assets <header_out>\n");
+        return EXIT_FAILURE;
+    }
+
+    u32 decode_peak = 0;
+
+    if (!app::write_asset_pack(argv[1], decode_peak))
+    {
+        printf("Error: app::write_asset_pack(%s)\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    printf("wrote %s\n", argv[1]);
+    printf("image decode memory: %u KB\n\n", (decode_peak + 1023) / 1024);
+
+    startup_timer::print_table();
+
+    return EXIT_SUCCESS;
+}
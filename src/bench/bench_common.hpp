@@ -0,0 +1,43 @@
+#pragma once
+
+#include "../util/types.hpp"
+#include "../util/profiler.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+
+// setup and frame time stats shared by the headless benches
+
+namespace bench
+{
+    // first thing in main, before app::init
+    inline void init_headless()
+    {
+        // no sound device needed
+        SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+
+        // the first frame does not pay for the profiler ring
+        PROFILE_THREAD();
+    }
+
+
+    // sorts frame_ns
+    inline void print_stats(std::vector<f64>& frame_ns, f64 total_ns)
+    {
+        std::sort(frame_ns.begin(), frame_ns.end());
+
+        auto const n = frame_ns.size();
+        auto const at = [&](f64 q){ return frame_ns[std::min((size_t)(q * n), n - 1)] / 1000.0; };
+
+        printf("frames %zu\n", n);
+        printf("min    %10.1f us\n", frame_ns.front() / 1000.0);
+        printf("median %10.1f us\n", at(0.5));
+        printf("p99    %10.1f us\n", at(0.99));
+        printf("max    %10.1f us\n", frame_ns.back() / 1000.0);
+        printf("fps    %10.1f\n", n * 1e9 / total_ns);
+    }
+}
@@ -0,0 +1,141 @@
+#include "../app/app.hpp"
+#include "../output/image.hpp"
+#include "../input/input_state.hpp"
+#include "../util/stopwatch.hpp"
+#include "../util/profiler.hpp"
+#include "bench_common.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+
+/* synthetic input */
+
+namespace
+{
+    constexpr u32 N_FRAMES = 2000;
+
+    // buttons hold their state for a few frames like a person typing
+    constexpr u32 HOLD_FRAMES = 7;
+
+
+    static u32 next_random(u32& state)
+    {
+        state = state * 1664525u + 1013904223u;
+        return state >> 8;
+    }
+
+
+    static void make_input(input::Input const& prev, input::Input& curr, u32 frame)
+    {
+        u32 rng = frame / HOLD_FRAMES + 1;
+
+        for (u32 i = 0; i < input::N_KEYBOARD_KEYS; i++)
+        {
+            input::record_button_input(prev.keyboard.keys[i], curr.keyboard.keys[i], next_random(rng) % 5 == 0);
+        }
+
+        for (u32 i = 0; i < input::N_MOUSE_BUTTONS; i++)
+        {
+            input::record_button_input(prev.mouse.buttons[i], curr.mouse.buttons[i], next_random(rng) % 4 == 0);
+        }
+
+        auto& controller = curr.controllers[0];
+        auto const& prev_controller = prev.controllers[0];
+
+        for (u32 i = 0; i < input::N_CONTROLLER_BUTTONS; i++)
+        {
+            input::record_button_input(prev_controller.buttons[i], controller.buttons[i], next_random(rng) % 6 == 0);
+        }
+
+        controller.trigger_left = (next_random(rng) % 3) * 0.5f;
+        controller.trigger_right = (next_random(rng) % 3) * 0.5f;
+        controller.stick_left.magnitude = (next_random(rng) % 2) * 0.5f;
+        controller.stick_right.magnitude = (next_random(rng) % 2) * 0.5f;
+
+        curr.mouse.window_pos.x = (i32)((frame / 3) % 544);
+        curr.mouse.window_pos.y = (i32)((frame / 5) % 368);
+        curr.mouse.wheel.y = frame % 11 == 0;
+
+        curr.num_controllers = 1;
+        curr.dt_frame = 1.0f / 60;
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    u32 n_frames = N_FRAMES;
+    if (argc > 1)
+    {
+        n_frames = (u32)std::max(1, std::atoi(argv[1]));
+    }
+
+    bench::init_headless();
+
+    app::AppState app_state{};
+    if (!app::init(app_state))
+    {
+        printf("Error: app::init()\n");
+        return EXIT_FAILURE;
+    }
+
+    // frames are not timed against the audio loader
+    app::wait_for_assets(app_state);
+
+    image::Image screen{};
+    if (!image::create_image(screen, app_state.screen.width, app_state.screen.height))
+    {
+        printf("Error: create_image()\n");
+        app::close(app_state);
+        return EXIT_FAILURE;
+    }
+
+    app_state.screen.matrix_data_ = screen.data_;
+
+    static input::Input input[2] = {};
+
+    std::vector<f64> frame_ns(n_frames);
+
+    Stopwatch total;
+    Stopwatch sw;
+
+    total.start();
+
+    for (u32 f = 0; f < n_frames; f++)
+    {
+        auto& input_curr = input[f & 1];
+        auto& input_prev = input[!(f & 1)];
+
+        make_input(input_prev, input_curr, f);
+
+        sw.start();
+        {
+            PROFILE_ZONE("app::update");
+            app::update(app_state, input_curr);
+        }
+        frame_ns[f] = sw.get_time_nano();
+    }
+
+    auto const total_ns = total.get_time_nano();
+
+    printf("screen %ux%u\n", app_state.screen.width, app_state.screen.height);
+    bench::print_stats(frame_ns, total_ns);
+
+#ifdef PROFILER_ON
+    if (!profiler::write_chrome_trace("bench_frame_trace.json"))
+    {
+        printf("Error: profiler::write_chrome_trace()\n");
+    }
+#endif
+
+    image::destroy_image(screen);
+    app::close(app_state);
+    SDL_Quit();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,478 @@
+#include "../output/image.cpp"
+#include "../util/util.cpp"
+#include "../util/stopwatch.hpp"
+
+#include <cstdio>
+#include <thread>
+
+namespace img = image;
+
+using Pixel = img::Pixel;
+using GrayView = img::GrayView;
+using GraySubView = img::GraySubView;
+using SubView = img::SubView;
+
+
+/* workload */
+
+namespace
+{
+    // same dimensions as the demo ui panels
+    constexpr u32 KEYBOARD_WIDTH = 272;
+    constexpr u32 KEYBOARD_HEIGHT = 92;
+    constexpr u32 MOUSE_WIDTH = 80;
+    constexpr u32 MOUSE_HEIGHT = 92;
+    constexpr u32 CONTROLLER_WIDTH = 192;
+    constexpr u32 CONTROLLER_HEIGHT = 92;
+
+    constexpr u32 SCREEN_WIDTH = KEYBOARD_WIDTH;
+    constexpr u32 SCREEN_HEIGHT = KEYBOARD_HEIGHT + CONTROLLER_HEIGHT;
+
+    constexpr u32 N_FRAMES = 2000;
+
+    constexpr Pixel COLOR_TABLE[5] =
+    {
+        img::to_pixel(0, 0, 0, 0),
+        img::to_pixel(0, 0, 0),
+        img::to_pixel(255, 255, 255),
+        img::to_pixel(0, 75, 168),
+        img::to_pixel(23, 190, 187)
+    };
+
+    constexpr auto BACKGROUND = img::to_pixel(115, 140, 153);
+
+
+    constexpr img::Palette make_palette()
+    {
+        img::Palette palette{};
+
+        for (u32 i = 0; i < 5; i++)
+        {
+            palette.colors[i] = COLOR_TABLE[i];
+        }
+
+        return palette;
+    }
+
+
+    static constexpr auto PALETTE = make_palette();
+
+
+    constexpr auto can_set_color_id = [](u8 current_id)
+    {
+        return current_id > 1;
+    };
+
+
+    constexpr auto to_render_color = [](u8 mask, Pixel color)
+    {
+        if (mask == 0)
+        {
+            return color;
+        }
+
+        return COLOR_TABLE[mask];
+    };
+
+
+    static Rect2Du32 to_rect(u32 x, u32 y, u32 width, u32 height)
+    {
+        Rect2Du32 range{};
+        range.x_begin = x;
+        range.x_end = x + width;
+        range.y_begin = y;
+        range.y_end = y + height;
+
+        return range;
+    }
+
+
+    class Panel
+    {
+    public:
+        GrayView filter;
+        GraySubView buttons;
+        SubView screen;
+    };
+
+
+    class Workload
+    {
+    public:
+        img::Image screen_image;
+        img::ImageView screen;
+
+        Panel keyboard;
+        Panel mouse;
+        Panel controller;
+
+        img::Buffer8 buffer;
+    };
+
+
+    static void make_panel(Panel& panel, u32 width, u32 height, Rect2Du32 screen_rect, Workload& w)
+    {
+        panel.filter = img::make_view(width, height, w.buffer);
+
+        // repeating transparent/black/white ids
+        auto data = panel.filter.matrix_data_;
+        for (u32 i = 0; i < width * height; i++)
+        {
+            data[i] = (u8)((i * 7 + i / width) % 3);
+        }
+
+        panel.buttons = img::sub_view(panel.filter, to_rect(0, 0, width, height));
+        panel.screen = img::sub_view(w.screen, screen_rect);
+    }
+
+
+    static bool create_workload(Workload& w)
+    {
+        if (!img::create_image(w.screen_image, SCREEN_WIDTH, SCREEN_HEIGHT))
+        {
+            return false;
+        }
+
+        w.screen = img::make_view(w.screen_image);
+
+        constexpr auto align = mb::SIMD_ALIGNMENT;
+
+        auto const n_filter =
+            mb::aligned_size(KEYBOARD_WIDTH * KEYBOARD_HEIGHT, align) +
+            mb::aligned_size(MOUSE_WIDTH * MOUSE_HEIGHT, align) +
+            mb::aligned_size(CONTROLLER_WIDTH * CONTROLLER_HEIGHT, align);
+
+        w.buffer = img::create_buffer8(n_filter);
+
+        make_panel(w.keyboard, KEYBOARD_WIDTH, KEYBOARD_HEIGHT, to_rect(0, 0, KEYBOARD_WIDTH, KEYBOARD_HEIGHT), w);
+        make_panel(w.controller, CONTROLLER_WIDTH, CONTROLLER_HEIGHT, to_rect(0, KEYBOARD_HEIGHT, CONTROLLER_WIDTH, CONTROLLER_HEIGHT), w);
+        make_panel(w.mouse, MOUSE_WIDTH, MOUSE_HEIGHT, to_rect(CONTROLLER_WIDTH, KEYBOARD_HEIGHT, MOUSE_WIDTH, MOUSE_HEIGHT), w);
+
+        return true;
+    }
+
+
+    static void destroy_workload(Workload& w)
+    {
+        img::destroy_image(w.screen_image);
+        mb::destroy_buffer(w.buffer);
+    }
+}
+
+
+/* frames */
+
+namespace
+{
+    template <class PRED, class FUNC>
+    static void render_panel(Panel const& panel, u32 frame, PRED const& pred, FUNC const& func)
+    {
+        auto const color_id = (u8)(3 + (frame & 1));
+
+        img::fill_if(panel.buttons, color_id, pred);
+        img::transform(panel.filter, panel.screen, func);
+    }
+
+
+    template <class PRED, class FUNC>
+    static void render_frame(Workload const& w, u32 frame, PRED const& pred, FUNC const& func)
+    {
+        img::fill(w.screen, BACKGROUND);
+
+        render_panel(w.keyboard, frame, pred, func);
+        render_panel(w.mouse, frame, pred, func);
+        render_panel(w.controller, frame, pred, func);
+    }
+
+
+    // transform replaced by the indexed blit
+    class PaletteBlit
+    {
+    public:
+        img::Palette const& palette;
+    };
+
+
+    static void render_panel(Panel const& panel, u32 frame, PaletteBlit const& blit)
+    {
+        auto const color_id = (u8)(3 + (frame & 1));
+
+        img::fill_if(panel.buttons, color_id, can_set_color_id);
+        img::transform_palette(panel.filter, panel.screen, blit.palette, 0);
+    }
+
+
+    static void render_frame(Workload const& w, u32 frame, PaletteBlit const& blit)
+    {
+        img::fill(w.screen, BACKGROUND);
+
+        render_panel(w.keyboard, frame, blit);
+        render_panel(w.mouse, frame, blit);
+        render_panel(w.controller, frame, blit);
+    }
+
+
+    static u64 checksum(img::ImageView const& view)
+    {
+        u64 sum = 0;
+
+        auto span = img::to_span(view);
+        for (u32 i = 0; i < span.length; i++)
+        {
+            auto p = span.begin[i];
+            sum = sum * 31 + (p.red ^ (p.green << 8) ^ (p.blue << 16));
+        }
+
+        return sum;
+    }
+
+
+    template <class... ARGS>
+    static f64 run_frames(cstr label, Workload const& w, ARGS const&... args)
+    {
+        Stopwatch sw;
+        sw.start();
+
+        for (u32 f = 0; f < N_FRAMES; f++)
+        {
+            render_frame(w, f, args...);
+        }
+
+        auto const ns_per_frame = sw.get_time_nano() / N_FRAMES;
+
+        printf("%-16s %10.1f ns/frame   checksum %016llx\n", label, ns_per_frame, (unsigned long long)checksum(w.screen));
+
+        return ns_per_frame;
+    }
+}
+
+
+/* span kernels */
+
+namespace
+{
+    constexpr u32 N_SPAN_REPS = 20;
+
+
+    static f64 time_kernels(simd::SpanKernels const& k, img::Image const& gray_src, img::Image const& src, img::Image& dst)
+    {
+        auto const length = dst.width * dst.height;
+
+        auto gray = (u8 const*)gray_src.data_;
+
+        Stopwatch sw;
+        sw.start();
+
+        for (u32 r = 0; r < N_SPAN_REPS; r++)
+        {
+            k.fill(dst.data_, length, BACKGROUND);
+            k.copy(src.data_, dst.data_, length);
+            k.palette(gray, dst.data_, length, PALETTE.colors, 0);
+        }
+
+        return sw.get_time_nano() / N_SPAN_REPS;
+    }
+
+
+    static bool check_kernels(simd::SpanKernels const& k, img::Image const& gray_src, img::Image const& src, img::Image& dst_scalar, img::Image& dst_simd)
+    {
+        auto const scalar = simd::scalar_kernels();
+
+        auto const length = src.width * src.height;
+        auto const bytes = length * sizeof(Pixel);
+
+        auto gray = (u8 const*)gray_src.data_;
+
+        // odd length exercises the scalar tail
+        auto const n = length - 3;
+
+        scalar.fill(dst_scalar.data_, n, BACKGROUND);
+        k.fill(dst_simd.data_, n, BACKGROUND);
+        auto same = std::memcmp(dst_scalar.data_, dst_simd.data_, bytes) == 0;
+
+        scalar.copy(src.data_, dst_scalar.data_, n);
+        k.copy(src.data_, dst_simd.data_, n);
+        same &= std::memcmp(dst_scalar.data_, dst_simd.data_, bytes) == 0;
+
+        scalar.palette(gray, dst_scalar.data_, n, PALETTE.colors, 0);
+        k.palette(gray, dst_simd.data_, n, PALETTE.colors, 0);
+        same &= std::memcmp(dst_scalar.data_, dst_simd.data_, bytes) == 0;
+
+        return same;
+    }
+
+
+    static bool run_span_kernels(u32 width, u32 height)
+    {
+        img::Image gray_src;
+        img::Image src;
+        img::Image dst_scalar;
+        img::Image dst_simd;
+
+        // gray source only needs width * height bytes
+        auto const ok =
+            img::create_image(gray_src, width, height) &&
+            img::create_image(src, width, height) &&
+            img::create_image(dst_scalar, width, height) &&
+            img::create_image(dst_simd, width, height);
+
+        if (!ok)
+        {
+            return false;
+        }
+
+        auto const length = width * height;
+
+        auto gray = (u8*)gray_src.data_;
+        for (u32 i = 0; i < length; i++)
+        {
+            gray[i] = (u8)(i * 13);
+            src.data_[i] = img::to_pixel((u8)i, (u8)(i >> 8), (u8)(i >> 16));
+        }
+
+        auto const scalar = simd::scalar_kernels();
+
+        auto const scalar_ns = time_kernels(scalar, gray_src, src, dst_scalar);
+        auto const simd_ns = time_kernels(img::span_kernels(), gray_src, src, dst_simd);
+
+        auto const same = check_kernels(img::span_kernels(), gray_src, src, dst_scalar, dst_simd);
+
+        printf("%ux%u fill+copy+palette\n", width, height);
+        printf("  %-14s %12.1f ns\n", scalar.name, scalar_ns);
+        printf("  %-14s %12.1f ns   %s\n", img::span_kernels().name, simd_ns, same ? "match" : "MISMATCH");
+
+        img::destroy_image(gray_src);
+        img::destroy_image(src);
+        img::destroy_image(dst_scalar);
+        img::destroy_image(dst_simd);
+
+        return same;
+    }
+}
+
+
+/* parallel */
+
+namespace
+{
+    static f64 time_frames(img::ImageView const& screen, GrayView const& mask, SubView const& dst, bool parallel)
+    {
+        Stopwatch sw;
+        sw.start();
+
+        for (u32 r = 0; r < N_SPAN_REPS; r++)
+        {
+            if (parallel)
+            {
+                img::fill_parallel(screen, BACKGROUND);
+                img::transform_palette_parallel(mask, dst, PALETTE, 0);
+            }
+            else
+            {
+                img::fill(screen, BACKGROUND);
+                img::transform_palette(mask, dst, PALETTE, 0);
+            }
+        }
+
+        return sw.get_time_nano() / N_SPAN_REPS;
+    }
+
+
+    static bool run_parallel(u32 width, u32 height)
+    {
+        img::Image serial_image;
+        img::Image parallel_image;
+        img::Buffer8 buffer;
+
+        auto const ok =
+            img::create_image(serial_image, width, height) &&
+            img::create_image(parallel_image, width, height) &&
+            mb::create_buffer(buffer, mb::aligned_size(width * height, mb::SIMD_ALIGNMENT));
+
+        if (!ok)
+        {
+            return false;
+        }
+
+        auto mask = img::make_view(width, height, buffer);
+        for (u32 i = 0; i < width * height; i++)
+        {
+            mask.matrix_data_[i] = (u8)(i % 5);
+        }
+
+        auto const serial_screen = img::make_view(serial_image);
+        auto const parallel_screen = img::make_view(parallel_image);
+
+        auto const full = to_rect(0, 0, width, height);
+
+        auto const serial_ns = time_frames(serial_screen, mask, img::sub_view(serial_screen, full), false);
+        auto const parallel_ns = time_frames(parallel_screen, mask, img::sub_view(parallel_screen, full), true);
+
+        auto const same = std::memcmp(serial_image.data_, parallel_image.data_, width * height * sizeof(Pixel)) == 0;
+
+        printf("%ux%u fill+palette\n", width, height);
+        printf("  %-14s %12.1f ns\n", "1 thread", serial_ns);
+        printf("  %2u %-11s %12.1f ns   %s\n", std::thread::hardware_concurrency(), "threads", parallel_ns, same ? "match" : "MISMATCH");
+
+        img::destroy_image(serial_image);
+        img::destroy_image(parallel_image);
+        mb::destroy_buffer(buffer);
+
+        return same;
+    }
+}
+
+
+int main()
+{
+    Workload w{};
+    if (!create_workload(w))
+    {
+        printf("Error: create_workload()\n");
+        return EXIT_FAILURE;
+    }
+
+    fn<bool(u8)> const pred_fn = can_set_color_id;
+    fn<Pixel(u8, Pixel)> const func_fn = to_render_color;
+
+    printf("screen %ux%u, %u frames\n", SCREEN_WIDTH, SCREEN_HEIGHT, N_FRAMES);
+
+    // warm up
+    render_frame(w, 0, can_set_color_id, to_render_color);
+
+    auto const fn_ns = run_frames("std::function", w, pred_fn, func_fn);
+    auto const tp_ns = run_frames("template", w, can_set_color_id, to_render_color);
+
+    auto const pl_ns = run_frames("palette", w, PaletteBlit{ PALETTE });
+
+    printf("speedup          %10.2fx / %.2fx\n\n", fn_ns / tp_ns, fn_ns / pl_ns);
+
+    destroy_workload(w);
+
+    auto const span_ok =
+        run_span_kernels(1920, 1080) &&
+        run_span_kernels(3840, 2160);
+
+    if (!span_ok)
+    {
+        return EXIT_FAILURE;
+    }
+
+    printf("\n");
+
+    auto const n_threads = std::thread::hardware_concurrency();
+    img::init_parallel(n_threads > 1 ? n_threads - 1 : 0, 0);
+
+    auto const parallel_ok =
+        run_parallel(1920, 1080) &&
+        run_parallel(3840, 2160);
+
+    img::close_parallel();
+
+    if (!parallel_ok)
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,156 @@
+#include "../sdl/sdl_include.hpp"
+#include "../output/image.cpp"
+#include "../util/util.cpp"
+#include "../util/stopwatch.hpp"
+#include "../app/app.hpp"
+
+#include <cstdio>
+
+namespace img = image;
+
+using Pixel = img::Pixel;
+
+
+/* presenters */
+
+namespace
+{
+    // same dimensions as the demo screen
+    constexpr u32 SCREEN_WIDTH = 272;
+    constexpr u32 SCREEN_HEIGHT = 184;
+
+    constexpr u32 N_FRAMES = 500;
+
+    constexpr auto BACKGROUND = img::to_pixel(115, 140, 153);
+
+
+    static Rect2Du32 to_rect(u32 x, u32 y, u32 width, u32 height)
+    {
+        Rect2Du32 range{};
+        range.x_begin = x;
+        range.x_end = x + width;
+        range.y_begin = y;
+        range.y_end = y + height;
+
+        return range;
+    }
+
+
+    static cstr presenter_name(sdl::Presenter presenter)
+    {
+        switch (presenter)
+        {
+        case sdl::Presenter::Renderer: return "renderer";
+        case sdl::Presenter::WindowSurface: return "window surface";
+        default: return "auto";
+        }
+    }
+
+
+    static cstr upload_name(sdl::UploadMode mode)
+    {
+        switch (mode)
+        {
+        case sdl::UploadMode::Full: return "full";
+        case sdl::UploadMode::DirtyRects: return "dirty rects";
+        case sdl::UploadMode::Tiles: return "tiles";
+        default: return "locked";
+        }
+    }
+
+
+    // changes one panel per frame like a key press in the demo
+    static void draw_frame(img::ImageView const& screen, img::DirtyRects& dirty, u32 frame)
+    {
+        img::clear_dirty(dirty);
+
+        auto const panel = to_rect((frame % 3) * 80, 92, 80, 92);
+        auto const color = img::to_pixel((u8)frame, (u8)(frame * 3), (u8)(frame * 7));
+
+        img::fill(img::sub_view(screen, panel), color);
+        img::mark_dirty(dirty, panel);
+    }
+
+
+    static bool run_presenter(sdl::Presenter presenter, sdl::UploadMode mode)
+    {
+        Vec2Du32 screen_dim{};
+        screen_dim.x = SCREEN_WIDTH;
+        screen_dim.y = SCREEN_HEIGHT;
+
+        Vec2Du32 window_dim{};
+        window_dim.x = config::WINDOW_SCALE * SCREEN_WIDTH;
+        window_dim.y = config::WINDOW_SCALE * SCREEN_HEIGHT;
+
+        sdl::ScreenMemory screen{};
+        screen.presenter = presenter;
+        screen.upload_mode = mode;
+
+        if (!sdl::create_screen_memory(screen, "bench_present", screen_dim, window_dim))
+        {
+            printf("%-16s %-12s unavailable\n", presenter_name(presenter), upload_name(mode));
+            return false;
+        }
+
+        auto view = img::make_view(screen.image);
+        img::DirtyRects dirty{};
+
+        img::fill(view, BACKGROUND);
+        sdl::render_screen(screen);
+
+        u64 total_bytes = 0;
+
+        Stopwatch sw;
+        sw.start();
+
+        for (u32 f = 0; f < N_FRAMES; f++)
+        {
+            draw_frame(view, dirty, f);
+            sdl::render_screen(screen, dirty);
+            total_bytes += screen.upload_bytes;
+        }
+
+        auto const ns_per_frame = sw.get_time_nano() / N_FRAMES;
+
+        printf("%-16s %-12s %10.1f us/frame %10llu bytes/frame\n",
+            presenter_name(presenter), upload_name(mode), ns_per_frame / 1000.0,
+            (unsigned long long)(total_bytes / N_FRAMES));
+
+        sdl::destroy_screen_memory(screen);
+
+        return true;
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    // headless unless a driver is given, e.g. SDL_VIDEODRIVER=offscreen
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+
+    if (SDL_Init(SDL_INIT_VIDEO) != 0)
+    {
+        printf("Error: SDL_Init()\n%s\n", SDL_GetError());
+        return EXIT_FAILURE;
+    }
+
+    printf("driver %s, screen %ux%u x%u, %u frames\n",
+        SDL_GetCurrentVideoDriver(), SCREEN_WIDTH, SCREEN_HEIGHT, config::WINDOW_SCALE, N_FRAMES);
+
+    sdl::Presenter const presenters[] = { sdl::Presenter::Renderer, sdl::Presenter::WindowSurface };
+    sdl::UploadMode const modes[] = { sdl::UploadMode::Full, sdl::UploadMode::DirtyRects, sdl::UploadMode::Tiles };
+
+    auto ok = true;
+
+    for (auto presenter : presenters)
+    {
+        for (auto mode : modes)
+        {
+            ok &= run_presenter(presenter, mode);
+        }
+    }
+
+    SDL_Quit();
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
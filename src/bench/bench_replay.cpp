@@ -0,0 +1,145 @@
+#include "../app/app.hpp"
+#include "../output/image.hpp"
+#include "../input/input_record.hpp"
+#include "frame_checksum.hpp"
+#include "bench_common.hpp"
+#include "../util/stopwatch.hpp"
+#include "../util/hash.hpp"
+#include "../util/profiler.hpp"
+
+#include <SDL2/SDL.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+
+/* screen hash */
+
+namespace
+{
+    // every frame's screen chained into one value, equal runs drew equal pixels
+    static u64 hash_screen(image::ImageView const& screen, u64 seed)
+    {
+        return hash::hash_bytes(screen.matrix_data_, (u64)screen.width * screen.height * sizeof(image::Pixel), seed);
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printf("usage: bench_replay <recording> [checksum_out]\n");
+        return EXIT_FAILURE;
+    }
+
+    static input::InputPlayback playback{};
+    if (!input::begin_playback(playback, argv[1]))
+    {
+        printf("Error: input::begin_playback(%s)\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    bench::init_headless();
+
+    app::AppState app_state{};
+    if (!app::init(app_state))
+    {
+        printf("Error: app::init()\n");
+        input::end_playback(playback);
+        return EXIT_FAILURE;
+    }
+
+    // frames are not timed against the audio loader, the screen does not depend on it
+    app::wait_for_assets(app_state);
+
+    image::Image screen{};
+    if (!image::create_image(screen, app_state.screen.width, app_state.screen.height))
+    {
+        printf("Error: create_image()\n");
+        app::close(app_state);
+        input::end_playback(playback);
+        return EXIT_FAILURE;
+    }
+
+    app_state.screen.matrix_data_ = screen.data_;
+
+    // hashes of every frame for compare_checksums
+    static frame_checksum::ChecksumFile sums{};
+    auto const checksum_path = argc > 2 ? argv[2] : nullptr;
+
+    if (checksum_path && !frame_checksum::create(sums, checksum_path, app_state.screen.width, app_state.screen.height))
+    {
+        printf("Error: frame_checksum::create(%s)\n", checksum_path);
+        image::destroy_image(screen);
+        app::close(app_state);
+        input::end_playback(playback);
+        return EXIT_FAILURE;
+    }
+
+    auto checksum_ok = true;
+
+    static input::Input input{};
+
+    std::vector<f64> frame_ns;
+    u64 screen_hash = 0;
+
+    Stopwatch sw;
+    f64 total_ns = 0.0;
+
+    while (input::next_frame(playback, input))
+    {
+        sw.start();
+        {
+            PROFILE_ZONE("app::update");
+            app::update(app_state, input);
+        }
+        auto const ns = sw.get_time_nano();
+
+        frame_ns.push_back(ns);
+        total_ns += ns;
+
+        screen_hash = hash_screen(app_state.screen, screen_hash);
+
+        if (checksum_path && checksum_ok && !frame_checksum::write_frame(sums, app_state.screen))
+        {
+            printf("Error: frame_checksum::write_frame()\n");
+            checksum_ok = false;
+        }
+    }
+
+    frame_checksum::close(sums);
+
+    auto const complete = !playback.is_corrupt;
+
+    if (frame_ns.empty())
+    {
+        printf("Error: no frames in %s\n", argv[1]);
+    }
+    else
+    {
+        printf("screen %ux%u\n", app_state.screen.width, app_state.screen.height);
+        bench::print_stats(frame_ns, total_ns);
+        printf("screen hash %016llx\n", (unsigned long long)screen_hash);
+    }
+
+    if (!complete)
+    {
+        printf("Error: corrupt frame after %llu frames\n", (unsigned long long)playback.n_frames);
+    }
+
+#ifdef PROFILER_ON
+    if (!profiler::write_chrome_trace("bench_replay_trace.json"))
+    {
+        printf("Error: profiler::write_chrome_trace()\n");
+    }
+#endif
+
+    image::destroy_image(screen);
+    app::close(app_state);
+    input::end_playback(playback);
+    SDL_Quit();
+
+    return complete && checksum_ok && !frame_ns.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,164 @@
+#include "frame_checksum.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+
+/* differing rects */
+
+namespace
+{
+    // runs of differing tiles in a row, joined with the same run in the row above
+    static std::vector<Rect2Du32> find_diff_rects(frame_checksum::ChecksumFile const& a, frame_checksum::ChecksumFile const& b)
+    {
+        auto const& header = a.header;
+        auto const tiles_a = a.frame + 1;
+        auto const tiles_b = b.frame + 1;
+
+        std::vector<Rect2Du32> rects;
+        size_t prev_row_begin = 0;
+
+        for (u32 ty = 0; ty < header.tiles_y; ty++)
+        {
+            auto const row_begin = rects.size();
+
+            u32 tx = 0;
+            while (tx < header.tiles_x)
+            {
+                auto const i = ty * header.tiles_x + tx;
+                if (tiles_a[i] == tiles_b[i])
+                {
+                    ++tx;
+                    continue;
+                }
+
+                auto const run_begin = tx;
+                while (tx < header.tiles_x && tiles_a[ty * header.tiles_x + tx] != tiles_b[ty * header.tiles_x + tx])
+                {
+                    ++tx;
+                }
+
+                auto rect = frame_checksum::tile_rect(header, run_begin, ty);
+                rect.x_end = frame_checksum::tile_rect(header, tx - 1, ty).x_end;
+
+                auto joined = false;
+                for (auto r = prev_row_begin; r < row_begin; r++)
+                {
+                    auto& above = rects[r];
+                    if (above.x_begin == rect.x_begin && above.x_end == rect.x_end && above.y_end == rect.y_begin)
+                    {
+                        above.y_end = rect.y_end;
+                        joined = true;
+                        break;
+                    }
+                }
+
+                if (!joined)
+                {
+                    rects.push_back(rect);
+                }
+            }
+
+            prev_row_begin = row_begin;
+        }
+
+        return rects;
+    }
+
+
+    static void print_rects(std::vector<Rect2Du32> const& rects)
+    {
+        for (auto const& r : rects)
+        {
+            printf("  x %u..%u  y %u..%u  (%ux%u)\n", r.x_begin, r.x_end, r.y_begin, r.y_end, r.x_end - r.x_begin, r.y_end - r.y_begin);
+        }
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        printf("usage: compare_checksums <checksum_a> <checksum_b>\n");
+        return EXIT_FAILURE;
+    }
+
+    static frame_checksum::ChecksumFile a{};
+    static frame_checksum::ChecksumFile b{};
+
+    auto const cleanup = [&]()
+    {
+        frame_checksum::close(a);
+        frame_checksum::close(b);
+    };
+
+    if (!frame_checksum::open(a, argv[1]) || !frame_checksum::open(b, argv[2]))
+    {
+        printf("Error: not a checksum file, %s or %s\n", argv[1], argv[2]);
+        cleanup();
+        return EXIT_FAILURE;
+    }
+
+    auto const& ha = a.header;
+    auto const& hb = b.header;
+
+    if (ha.width != hb.width || ha.height != hb.height || ha.tile_size != hb.tile_size)
+    {
+        printf("Error: screens differ, %ux%u tile %u and %ux%u tile %u\n", ha.width, ha.height, ha.tile_size, hb.width, hb.height, hb.tile_size);
+        cleanup();
+        return EXIT_FAILURE;
+    }
+
+    u64 n_diff_frames = 0;
+    u64 first_diff = 0;
+
+    while (true)
+    {
+        auto const has_a = frame_checksum::read_frame(a);
+        auto const has_b = frame_checksum::read_frame(b);
+
+        if (!has_a || !has_b)
+        {
+            break;
+        }
+
+        if (a.frame[0] == b.frame[0])
+        {
+            continue;
+        }
+
+        if (!n_diff_frames)
+        {
+            auto const rects = find_diff_rects(a, b);
+
+            first_diff = a.n_frames - 1;
+            printf("first divergent frame %llu, %zu rects\n", (unsigned long long)first_diff, rects.size());
+            print_rects(rects);
+        }
+
+        ++n_diff_frames;
+    }
+
+    auto const same_length = a.n_frames == b.n_frames;
+
+    if (!same_length)
+    {
+        printf("frame counts differ, %s has more than %llu frames\n", a.n_frames > b.n_frames ? argv[1] : argv[2],
+            (unsigned long long)std::min(a.n_frames, b.n_frames));
+    }
+
+    if (n_diff_frames)
+    {
+        printf("%llu of %llu frames differ\n", (unsigned long long)n_diff_frames, (unsigned long long)std::min(a.n_frames, b.n_frames));
+    }
+    else
+    {
+        printf("%llu frames match\n", (unsigned long long)std::min(a.n_frames, b.n_frames));
+    }
+
+    cleanup();
+
+    return n_diff_frames || !same_length ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "../output/output.hpp"
+#include "../util/hash.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+
+
+// per frame hashes of the screen for comparing the output of two builds
+// each frame stores a hash of the whole screen and one per tile
+// so a mismatch can be traced to the regions that differ
+
+namespace frame_checksum
+{
+    constexpr u32 CHECKSUM_MAGIC = 0x43'4C'44'53; // "SDLC"
+    constexpr u32 CHECKSUM_VERSION = 1;
+
+    constexpr u32 TILE_SIZE = 32;
+
+
+    class ChecksumHeader
+    {
+    public:
+        u32 magic;
+        u32 version;
+
+        u32 width;
+        u32 height;
+        u32 tile_size;
+        u32 tiles_x;
+        u32 tiles_y;
+
+        u32 reserved;
+    };
+
+
+    class ChecksumFile
+    {
+    public:
+        FILE* file = nullptr;
+
+        ChecksumHeader header;
+
+        // frame hash followed by the tile hashes, row major
+        u64* frame = nullptr;
+
+        u64 n_frames = 0;
+    };
+
+
+    inline u32 n_tiles(ChecksumHeader const& header)
+    {
+        return header.tiles_x * header.tiles_y;
+    }
+
+
+    inline Rect2Du32 tile_rect(ChecksumHeader const& header, u32 tile_x, u32 tile_y)
+    {
+        auto const size = header.tile_size;
+
+        Rect2Du32 rect{};
+        rect.x_begin = tile_x * size;
+        rect.x_end = std::min(rect.x_begin + size, header.width);
+        rect.y_begin = tile_y * size;
+        rect.y_end = std::min(rect.y_begin + size, header.height);
+
+        return rect;
+    }
+
+
+    inline void close(ChecksumFile& sums)
+    {
+        if (sums.file)
+        {
+            fclose(sums.file);
+            sums.file = nullptr;
+        }
+
+        if (sums.frame)
+        {
+            std::free(sums.frame);
+            sums.frame = nullptr;
+        }
+    }
+
+
+    inline bool allocate_frame(ChecksumFile& sums)
+    {
+        sums.frame = (u64*)std::malloc((1 + n_tiles(sums.header)) * sizeof(u64));
+
+        return sums.frame != nullptr;
+    }
+
+
+    inline bool create(ChecksumFile& sums, cstr path, u32 width, u32 height)
+    {
+        auto& header = sums.header;
+        header.magic = CHECKSUM_MAGIC;
+        header.version = CHECKSUM_VERSION;
+        header.width = width;
+        header.height = height;
+        header.tile_size = TILE_SIZE;
+        header.tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+        header.tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+        header.reserved = 0;
+
+        sums.file = fopen(path, "wb");
+        if (!sums.file || !allocate_frame(sums))
+        {
+            close(sums);
+            return false;
+        }
+
+        if (fwrite(&header, sizeof(header), 1, sums.file) != 1)
+        {
+            close(sums);
+            return false;
+        }
+
+        sums.n_frames = 0;
+
+        return true;
+    }
+
+
+    inline bool open(ChecksumFile& sums, cstr path)
+    {
+        sums.file = fopen(path, "rb");
+        if (!sums.file)
+        {
+            return false;
+        }
+
+        auto& header = sums.header;
+
+        if (fread(&header, sizeof(header), 1, sums.file) != 1 ||
+            header.magic != CHECKSUM_MAGIC || header.version != CHECKSUM_VERSION ||
+            !header.tile_size || header.tiles_x != (header.width + header.tile_size - 1) / header.tile_size ||
+            header.tiles_y != (header.height + header.tile_size - 1) / header.tile_size)
+        {
+            close(sums);
+            return false;
+        }
+
+        if (!allocate_frame(sums))
+        {
+            close(sums);
+            return false;
+        }
+
+        sums.n_frames = 0;
+
+        return true;
+    }
+
+
+    // hashes the screen into sums.frame and appends it to the file
+    inline bool write_frame(ChecksumFile& sums, image::ImageView const& screen)
+    {
+        auto const& header = sums.header;
+
+        assert(screen.width == header.width);
+        assert(screen.height == header.height);
+
+        auto tile_hashes = sums.frame + 1;
+
+        for (u32 ty = 0; ty < header.tiles_y; ty++)
+        {
+            for (u32 tx = 0; tx < header.tiles_x; tx++)
+            {
+                auto const rect = tile_rect(header, tx, ty);
+                auto const row_bytes = (u64)(rect.x_end - rect.x_begin) * sizeof(image::Pixel);
+
+                u64 h = 0;
+                for (u32 y = rect.y_begin; y < rect.y_end; y++)
+                {
+                    auto row = screen.matrix_data_ + (u64)y * screen.matrix_width + rect.x_begin;
+                    h = hash::hash_bytes(row, row_bytes, h);
+                }
+
+                tile_hashes[ty * header.tiles_x + tx] = h;
+            }
+        }
+
+        sums.frame[0] = hash::hash_bytes(tile_hashes, n_tiles(header) * sizeof(u64));
+
+        auto const n_words = 1 + n_tiles(header);
+        if (fwrite(sums.frame, sizeof(u64), n_words, sums.file) != n_words)
+        {
+            return false;
+        }
+
+        sums.n_frames++;
+
+        return true;
+    }
+
+
+    // returns false at the end of the file
+    inline bool read_frame(ChecksumFile& sums)
+    {
+        auto const n_words = 1 + n_tiles(sums.header);
+        if (fread(sums.frame, sizeof(u64), n_words, sums.file) != n_words)
+        {
+            return false;
+        }
+
+        sums.n_frames++;
+
+        return true;
+    }
+}
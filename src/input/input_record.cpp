@@ -0,0 +1,333 @@
+#include "input_record.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+
+namespace input
+{
+    constexpr u32 RECORD_MAGIC = 0x49'4C'44'53; // "SDLI"
+    constexpr u32 RECORD_VERSION = 1;
+
+    constexpr u32 N_INPUT_WORDS = sizeof(Input) / sizeof(u32);
+
+    static_assert(sizeof(Input) % sizeof(u32) == 0);
+
+    // a varint is at most 5 bytes, every word changed in single word runs is the worst case
+    constexpr u32 MAX_FRAME_BYTES = N_INPUT_WORDS * (sizeof(u32) + 2 * 5);
+
+    // unchanged words shorter than this are stored rather than starting a new run
+    constexpr u32 MIN_SKIP_WORDS = 2;
+
+
+    class RecordHeader
+    {
+    public:
+        u32 magic;
+        u32 version;
+
+        // recordings from a build with other keys or controllers do not decode
+        u32 input_size;
+
+        u32 reserved;
+    };
+
+
+    static u32 write_varint(u8* dst, u32 value)
+    {
+        u32 n = 0;
+        while (value >= 0x80)
+        {
+            dst[n++] = (u8)(value | 0x80);
+            value >>= 7;
+        }
+
+        dst[n++] = (u8)value;
+
+        return n;
+    }
+
+
+    static bool read_varint(InputPlayback& playback, u32& value)
+    {
+        value = 0;
+
+        for (u32 shift = 0; shift < 35; shift += 7)
+        {
+            if (playback.offset >= playback.size)
+            {
+                return false;
+            }
+
+            auto const byte = playback.data[playback.offset++];
+            value |= (u32)(byte & 0x7F) << shift;
+
+            if (!(byte & 0x80))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+
+    static void to_words(Input const& input, u32* words)
+    {
+        std::memcpy(words, &input, sizeof(Input));
+    }
+
+
+    // frame: (skip, count, count words) runs until every word is covered
+    static u32 encode_frame(u32 const* prev, u32 const* curr, u8* dst)
+    {
+        u32 n_bytes = 0;
+        u32 w = 0;
+
+        while (w < N_INPUT_WORDS)
+        {
+            auto const run_begin = w;
+            while (w < N_INPUT_WORDS && curr[w] == prev[w])
+            {
+                ++w;
+            }
+
+            auto const skip = w - run_begin;
+            auto const changed_begin = w;
+
+            while (w < N_INPUT_WORDS)
+            {
+                if (curr[w] != prev[w])
+                {
+                    ++w;
+                    continue;
+                }
+
+                // short gaps cost less as data than as another run
+                u32 gap = 0;
+                while (w + gap < N_INPUT_WORDS && gap < MIN_SKIP_WORDS && curr[w + gap] == prev[w + gap])
+                {
+                    ++gap;
+                }
+
+                if (gap == MIN_SKIP_WORDS || w + gap == N_INPUT_WORDS)
+                {
+                    break;
+                }
+
+                w += gap;
+            }
+
+            auto const count = w - changed_begin;
+
+            n_bytes += write_varint(dst + n_bytes, skip);
+            n_bytes += write_varint(dst + n_bytes, count);
+
+            std::memcpy(dst + n_bytes, curr + changed_begin, count * sizeof(u32));
+            n_bytes += count * sizeof(u32);
+        }
+
+        return n_bytes;
+    }
+
+
+    bool begin_recording(InputRecorder& recorder, cstr path)
+    {
+        recorder.file = fopen(path, "wb");
+        if (!recorder.file)
+        {
+            return false;
+        }
+
+        recorder.frame_bytes = (u8*)std::malloc(MAX_FRAME_BYTES);
+        if (!recorder.frame_bytes)
+        {
+            end_recording(recorder);
+            return false;
+        }
+
+        RecordHeader header{};
+        header.magic = RECORD_MAGIC;
+        header.version = RECORD_VERSION;
+        header.input_size = (u32)sizeof(Input);
+
+        if (fwrite(&header, sizeof(header), 1, recorder.file) != 1)
+        {
+            end_recording(recorder);
+            return false;
+        }
+
+        // the first frame is a delta from all zeros
+        std::memset(&recorder.prev, 0, sizeof(Input));
+        recorder.n_frames = 0;
+        recorder.n_bytes = sizeof(header);
+
+        return true;
+    }
+
+
+    bool record_frame(InputRecorder& recorder, Input const& input)
+    {
+        u32 prev[N_INPUT_WORDS];
+        u32 curr[N_INPUT_WORDS];
+
+        to_words(recorder.prev, prev);
+        to_words(input, curr);
+
+        auto const n_bytes = encode_frame(prev, curr, recorder.frame_bytes);
+
+        if (fwrite(recorder.frame_bytes, 1, n_bytes, recorder.file) != n_bytes)
+        {
+            return false;
+        }
+
+        std::memcpy(&recorder.prev, &input, sizeof(Input));
+        recorder.n_frames++;
+        recorder.n_bytes += n_bytes;
+
+        return true;
+    }
+
+
+    void end_recording(InputRecorder& recorder)
+    {
+        if (recorder.file)
+        {
+            fclose(recorder.file);
+            recorder.file = nullptr;
+        }
+
+        if (recorder.frame_bytes)
+        {
+            std::free(recorder.frame_bytes);
+            recorder.frame_bytes = nullptr;
+        }
+    }
+
+
+    bool begin_playback(InputPlayback& playback, cstr path)
+    {
+        auto file = fopen(path, "rb");
+        if (!file)
+        {
+            return false;
+        }
+
+        fseek(file, 0, SEEK_END);
+        auto const size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        if (size < (long)sizeof(RecordHeader))
+        {
+            fclose(file);
+            return false;
+        }
+
+        playback.data = (u8*)std::malloc((size_t)size);
+        if (!playback.data)
+        {
+            fclose(file);
+            return false;
+        }
+
+        auto const n_read = fread(playback.data, 1, (size_t)size, file);
+        fclose(file);
+
+        if (n_read != (size_t)size)
+        {
+            end_playback(playback);
+            return false;
+        }
+
+        RecordHeader header{};
+        std::memcpy(&header, playback.data, sizeof(header));
+
+        if (header.magic != RECORD_MAGIC || header.version != RECORD_VERSION || header.input_size != (u32)sizeof(Input))
+        {
+            end_playback(playback);
+            return false;
+        }
+
+        playback.size = (u64)size;
+        playback.offset = sizeof(header);
+        playback.n_frames = 0;
+        playback.is_corrupt = 0;
+
+        std::memset(&playback.curr, 0, sizeof(Input));
+
+        return true;
+    }
+
+
+    static bool decode_frame(InputPlayback& playback, u32* words)
+    {
+        u32 w = 0;
+        while (w < N_INPUT_WORDS)
+        {
+            u32 skip = 0;
+            u32 count = 0;
+
+            if (!read_varint(playback, skip) || !read_varint(playback, count))
+            {
+                return false;
+            }
+
+            if (skip > N_INPUT_WORDS - w || count > N_INPUT_WORDS - w - skip)
+            {
+                return false;
+            }
+
+            w += skip;
+
+            auto const n_bytes = count * sizeof(u32);
+            if (playback.size - playback.offset < n_bytes)
+            {
+                return false;
+            }
+
+            std::memcpy(words + w, playback.data + playback.offset, n_bytes);
+
+            playback.offset += n_bytes;
+            w += count;
+        }
+
+        return true;
+    }
+
+
+    bool next_frame(InputPlayback& playback, Input& input)
+    {
+        if (!playback.data || playback.is_corrupt || playback.offset >= playback.size)
+        {
+            return false;
+        }
+
+        u32 words[N_INPUT_WORDS];
+        to_words(playback.curr, words);
+
+        if (!decode_frame(playback, words))
+        {
+            playback.is_corrupt = 1;
+            return false;
+        }
+
+        std::memcpy(&playback.curr, words, sizeof(Input));
+        std::memcpy(&input, words, sizeof(Input));
+        playback.n_frames++;
+
+        return true;
+    }
+
+
+    void end_playback(InputPlayback& playback)
+    {
+        if (playback.data)
+        {
+            std::free(playback.data);
+            playback.data = nullptr;
+        }
+
+        playback.size = 0;
+        playback.offset = 0;
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "input.hpp"
+
+#include <cstdio>
+
+
+// binary input recordings for repeatable runs
+// each frame stores only the 32 bit words of Input that changed from the frame before
+
+namespace input
+{
+	class InputRecorder
+	{
+	public:
+		FILE* file = nullptr;
+
+		Input prev;
+
+		// encoded frame, written with one fwrite
+		u8* frame_bytes = nullptr;
+
+		u64 n_frames = 0;
+		u64 n_bytes = 0;
+	};
+
+
+	class InputPlayback
+	{
+	public:
+		// the whole recording, decoding does no file io
+		u8* data = nullptr;
+		u64 size = 0;
+		u64 offset = 0;
+
+		Input curr;
+
+		u64 n_frames = 0;
+
+		// a frame ran past the end of the data or the Input
+		b32 is_corrupt = 0;
+	};
+
+
+	bool begin_recording(InputRecorder& recorder, cstr path);
+
+	bool record_frame(InputRecorder& recorder, Input const& input);
+
+	void end_recording(InputRecorder& recorder);
+
+
+	// fails if the file was recorded with a different Input layout
+	bool begin_playback(InputPlayback& playback, cstr path);
+
+	// returns false at the end of the recording or on a corrupt frame
+	bool next_frame(InputPlayback& playback, Input& input);
+
+	void end_playback(InputPlayback& playback);
+}
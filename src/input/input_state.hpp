@@ -138,3 +138,56 @@ namespace input
 	}
 }
 
+
+
+/* fixed step */
+
+namespace input
+{
+	inline void merge_button_edges(ButtonState const& src, ButtonState& dst)
+	{
+		dst.pressed |= src.pressed;
+		dst.raised |= src.raised;
+	}
+
+
+	// keeps the presses and releases of a frame that ran no simulation step
+	inline void merge_input_edges(Input const& src, Input& dst)
+	{
+		for (u32 i = 0; i < N_KEYBOARD_KEYS; ++i)
+		{
+			merge_button_edges(src.keyboard.keys[i], dst.keyboard.keys[i]);
+		}
+
+		for (u32 i = 0; i < N_MOUSE_BUTTONS; ++i)
+		{
+			merge_button_edges(src.mouse.buttons[i], dst.mouse.buttons[i]);
+		}
+
+#if MOUSE_WHEEL
+		dst.mouse.wheel.x += src.mouse.wheel.x;
+		dst.mouse.wheel.y += src.mouse.wheel.y;
+#endif
+
+		for (u32 c = 0; c < src.num_controllers; ++c)
+		{
+			for (u32 i = 0; i < N_CONTROLLER_BUTTONS; ++i)
+			{
+				merge_button_edges(src.controllers[c].buttons[i], dst.controllers[c].buttons[i]);
+			}
+		}
+	}
+
+
+	// input for the second and later steps of one frame
+	inline void clear_input_edges(Input& input)
+	{
+		copy_keyboard_state(input.keyboard, input.keyboard);
+		copy_mouse_state(input.mouse, input.mouse);
+
+		for (u32 c = 0; c < input.num_controllers; ++c)
+		{
+			copy_controller_buttons(input.controllers[c], input.controllers[c]);
+		}
+	}
+}
@@ -13,6 +13,13 @@ namespace audio
 
     bool load_sound_from_file(cstr sound_file_path, Sound& sound);
 
+    // the bytes of a whole file, read on any thread
+    // a sound is decoded up front, the bytes can be freed once it returns
+    bool load_sound_from_memory(u8 const* bytes, u32 n_bytes, Sound& sound);
+
+    // music streams from the bytes while it plays, free them after destroy_music
+    bool load_music_from_memory(u8 const* bytes, u32 n_bytes, Music& music);
+
     f32 set_music_volume(f32 volume);
 
     f32 set_sound_volume(f32 volume);
@@ -1,6 +1,10 @@
 #include "image.hpp"
+#include "image_simd.hpp"
+#include "../util/thread_pool.hpp"
 #include "../util/stb_image/stb_image.h"
+#include "../util/stb_image/stb_image_alloc.hpp"
 
+#include <algorithm>
 #include <cstring>
 
 namespace image
@@ -35,47 +39,6 @@ namespace image
 }
 
 
-/* row_begin */
-
-namespace image
-{
-    template <typename T>
-	static inline SpanView<T> row_begin(MatrixView2D<T> const& view, u32 y)
-	{
-        SpanView<T> span{};
-
-        span.begin = view.matrix_data_ + (u64)(y * view.width);
-        span.length = view.width;
-
-        return span;
-	}
-
-
-    template <typename T>
-    static inline SpanView<T> row_begin(MatrixSubView2D<T> const& view, u32 y)
-    {
-        SpanView<T> span{};
-
-        span.begin = view.matrix_data_ + (u64)((view.y_begin + y) * view.matrix_width + view.x_begin);
-        span.length = view.width;
-
-        return span;
-    }
-
-
-    template <typename T>
-    static inline SpanView<T> to_span(MatrixView2D<T> const& view)
-    {
-        SpanView<T> span{};
-
-        span.begin = view.matrix_data_;
-        span.length = view.width * view.height;
-
-        return span;
-    }
-}
-
-
 /* make_view */
 
 namespace image
@@ -86,6 +49,7 @@ namespace image
 
         view.width = image.width;
         view.height = image.height;
+        view.matrix_width = image.width;
         view.matrix_data_ = image.data_;
 
         return view;
@@ -96,11 +60,13 @@ namespace image
     {
         GrayView view{};
 
-        view.matrix_data_ = mb::push_elements(buffer, width * height);
+        // each view starts on a cache line for the simd kernels
+        view.matrix_data_ = mb::push<u8>(buffer, width * height, mb::SIMD_ALIGNMENT);
         if (view.matrix_data_)
         {
             view.width = width;
             view.height = height;
+            view.matrix_width = width;
         }
 
         return view;
@@ -108,33 +74,48 @@ namespace image
 }
 
 
-/* fill */
+/* simd */
 
 namespace image
 {
-    template <typename T>
-	static inline void fill_span(SpanView<T> const& dst, T value)
-	{
-		for (u32 i = 0; i < dst.length; ++i)
-		{
-			dst.begin[i] = value;
-		}
-	}
+    // picked on first use, image calls from other static initializers find them ready
+    static simd::SpanKernels const& span_kernels()
+    {
+        static const simd::SpanKernels kernels = simd::select_kernels();
+
+        return kernels;
+    }
 
 
-    template <typename T>
-    static void fill_span_if(SpanView<T> const& dst, u8 value, fn<bool(T)> const& pred)
+    cstr simd_name()
     {
-        for (u32 i = 0; i < dst.length; ++i)
-		{
-			dst.begin[i] = pred(dst.begin[i]) ? value : dst.begin[i];
-		}
+        return span_kernels().name;
     }
+}
+
+
+/* fill */
+
+namespace image
+{
+    static inline void fill_span(SpanView<Pixel> const& dst, Pixel value)
+	{
+		span_kernels().fill(dst.begin, dst.length, value);
+	}
 
 
     void fill(ImageView const& view, Pixel color)
     {
-        fill_span(to_span(view), color);
+        if (is_contiguous(view))
+        {
+            fill_span(to_span(view), color);
+            return;
+        }
+
+        for (u32 y = 0; y < view.height; y++)
+        {
+            fill_span(row_begin(view, y), color);
+        }
     }
 
 
@@ -149,43 +130,56 @@ namespace image
 
     void fill_if(GraySubView const& view, u8 gray, fn<bool(u8)> const& pred)
     {
-        for (u32 y = 0; y < view.height; y++)
-        {
-            fill_span_if(row_begin(view, y), gray, pred);
-        }
+        fill_if<fn<bool(u8)>>(view, gray, pred);
     }
 }
 
 
-/* transform */
+/* copy */
 
 namespace image
 {
-    static void transform_span(SpanView<u8> const& src, SpanView<Pixel> const& dst, fn<Pixel(u8, Pixel)> const& func)
+    static inline void copy_span(SpanView<Pixel> const& src, SpanView<Pixel> const& dst)
     {
-        auto s = src.begin;
-        auto d = dst.begin;
+        span_kernels().copy(src.begin, dst.begin, src.length);
+    }
+
 
-        for (u32 i = 0; i < src.length; i++)
+    void copy(ImageView const& src, ImageView const& dst)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        if (is_contiguous(src) && is_contiguous(dst))
         {
-            d[i] = func(s[i], d[i]);
+            copy_span(to_span(src), to_span(dst));
+            return;
+        }
+
+        for (u32 y = 0; y < src.height; y++)
+        {
+            copy_span(row_begin(src, y), row_begin(dst, y));
         }
     }
 
 
-    static void transform_span(SpanView<Pixel> const& src, SpanView<u8> const& dst, fn<u8(Pixel)> const& func)
+    void copy(ImageView const& src, SubView const& dst)
     {
-        auto s = src.begin;
-        auto d = dst.begin;
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
 
-        for (u32 i = 0; i < src.length; i++)
+        for (u32 y = 0; y < src.height; y++)
         {
-            d[i] = func(s[i]);
+            copy_span(row_begin(src, y), row_begin(dst, y));
         }
     }
 
 
-    void transform(GrayView const& src, SubView const& dst, fn<Pixel(u8, Pixel)> const& func)
+    void copy(SubView const& src, SubView const& dst)
     {
         assert(src.matrix_data_);
         assert(dst.matrix_data_);
@@ -194,12 +188,56 @@ namespace image
 
         for (u32 y = 0; y < src.height; y++)
         {
-            transform_span(row_begin(src, y), row_begin(dst, y), func);
+            copy_span(row_begin(src, y), row_begin(dst, y));
         }
     }
+}
+
+
+/* transform */
+
+namespace image
+{
+    using gray_to_pixel_fn = fn<Pixel(u8, Pixel)>;
+    using pixel_to_gray_fn = fn<u8(Pixel)>;
+
+
+    void transform(GrayView const& src, SubView const& dst, gray_to_pixel_fn const& func)
+    {
+        transform<gray_to_pixel_fn>(src, dst, func);
+    }
 
 
-    void transform(GraySubView const& src, SubView const& dst, fn<Pixel(u8, Pixel)> const& func)
+    void transform(GraySubView const& src, SubView const& dst, gray_to_pixel_fn const& func)
+    {
+        transform<gray_to_pixel_fn>(src, dst, func);
+    }
+
+
+    void transform(ImageView const& src, GrayView const& dst, pixel_to_gray_fn const& func)
+    {
+        transform<pixel_to_gray_fn>(src, dst, func);
+    }
+
+
+    void transform_scale_up(ImageView const& src, GrayView const& dst, u32 scale, pixel_to_gray_fn const& func)
+    {
+        transform_scale_up<pixel_to_gray_fn>(src, dst, scale, func);
+    }
+}
+
+
+/* palette */
+
+namespace image
+{
+    static inline void palette_span(SpanView<u8> const& src, SpanView<Pixel> const& dst, Palette const& palette, u8 transparent_index)
+    {
+        span_kernels().palette(src.begin, dst.begin, src.length, palette.colors, transparent_index);
+    }
+
+
+    void transform_palette(GrayView const& src, SubView const& dst, Palette const& palette, u8 transparent_index)
     {
         assert(src.matrix_data_);
         assert(dst.matrix_data_);
@@ -208,49 +246,227 @@ namespace image
 
         for (u32 y = 0; y < src.height; y++)
         {
-            transform_span(row_begin(src, y), row_begin(dst, y), func);
+            palette_span(row_begin(src, y), row_begin(dst, y), palette, transparent_index);
         }
     }
 
 
-    void transform(ImageView const& src, GrayView const& dst, fn<u8(Pixel)> const& func)
+    void transform_palette(GraySubView const& src, SubView const& dst, Palette const& palette, u8 transparent_index)
     {
         assert(src.matrix_data_);
         assert(dst.matrix_data_);
         assert(dst.width == src.width);
         assert(dst.height == src.height);
 
-        transform_span(to_span(src), to_span(dst), func);
+        for (u32 y = 0; y < src.height; y++)
+        {
+            palette_span(row_begin(src, y), row_begin(dst, y), palette, transparent_index);
+        }
     }
+}
 
 
-    void transform_scale_up(ImageView const& src, GrayView const& dst, u32 scale, fn<u8(Pixel)> const& func)
+/* parallel */
+
+namespace image
+{
+    static thread_pool::ThreadPool row_pool;
+    static u32 parallel_min_pixels = 0;
+
+
+    bool init_parallel(u32 n_workers, u32 min_pixels)
     {
-        assert(src.matrix_data_);
-        assert(dst.matrix_data_);
-        assert(dst.width == src.width * scale);
-        assert(dst.height == src.height * scale);
+        close_parallel();
+
+        parallel_min_pixels = min_pixels;
+
+        if (!n_workers)
+        {
+            return true;
+        }
+
+        return thread_pool::create_pool(row_pool, n_workers);
+    }
+
+
+    void close_parallel()
+    {
+        thread_pool::destroy_pool(row_pool);
+    }
+
+
+    void process_row_bands(u32 width, u32 height, fn<void(u32, u32)> const& band)
+    {
+        auto const n_threads = row_pool.n_workers + 1;
+
+        if (n_threads == 1 || (u64)width * height < parallel_min_pixels || height < n_threads)
+        {
+            band(0, height);
+            return;
+        }
+
+        thread_pool::execute(row_pool, n_threads, [&](u32 id)
+        {
+            auto const y_begin = (u32)((u64)height * id / n_threads);
+            auto const y_end = (u32)((u64)height * (id + 1) / n_threads);
+
+            band(y_begin, y_end);
+        });
+    }
+
+
+    void fill_parallel(ImageView const& view, Pixel color)
+    {
+        process_row_bands(view.width, view.height, [&](u32 y_begin, u32 y_end)
+        {
+            fill(row_band(view, y_begin, y_end), color);
+        });
+    }
+
+
+    void fill_parallel(SubView const& view, Pixel color)
+    {
+        process_row_bands(view.width, view.height, [&](u32 y_begin, u32 y_end)
+        {
+            fill(row_band(view, y_begin, y_end), color);
+        });
+    }
+}
+
+
+/* damage */
+
+namespace image
+{
+    static inline bool is_empty(Rect2Du32 const& rect)
+    {
+        return rect.x_begin >= rect.x_end || rect.y_begin >= rect.y_end;
+    }
+
 
-        for (u32 src_y = 0; src_y < src.height; src_y++)
+    static inline bool overlaps(Rect2Du32 const& a, Rect2Du32 const& b)
+    {
+        return 
+            a.x_begin < b.x_end && b.x_begin < a.x_end &&
+            a.y_begin < b.y_end && b.y_begin < a.y_end;
+    }
+
+
+    static inline Rect2Du32 bounding_box(Rect2Du32 const& a, Rect2Du32 const& b)
+    {
+        Rect2Du32 box{};
+        box.x_begin = std::min(a.x_begin, b.x_begin);
+        box.x_end = std::max(a.x_end, b.x_end);
+        box.y_begin = std::min(a.y_begin, b.y_begin);
+        box.y_end = std::max(a.y_end, b.y_end);
+
+        return box;
+    }
+
+
+    void clear_dirty(DirtyRects& dirty)
+    {
+        dirty.count = 0;
+    }
+
+
+    void mark_dirty(DirtyRects& dirty, Rect2Du32 const& rect)
+    {
+        if (is_empty(rect))
         {
-            auto src_row = row_begin(src, src_y);
-            for (u32 src_x = 0; src_x < src.width; src_x++)
+            return;
+        }
+
+        auto merged = rect;
+
+        // absorb every rect the new one touches, repeat since the box grows
+        for (u32 i = 0; i < dirty.count;)
+        {
+            if (overlaps(dirty.rects[i], merged))
             {
-                auto const value = func(src_row.begin[src_x]);
-
-                auto dst_y = src_y * scale;
-                for (u32 offset_y = 0; offset_y < scale; offset_y++, dst_y++)
-                {
-                    auto dst_row = row_begin(dst, dst_y);
-
-                    auto dst_x = src_x * scale;
-                    for (u32 offset_x = 0; offset_x < scale; offset_x++, dst_x++)
-                    {
-                        dst_row.begin[dst_x] = value;
-                    }
-                }
+                merged = bounding_box(dirty.rects[i], merged);
+                dirty.rects[i] = dirty.rects[--dirty.count];
+                i = 0;
+            }
+            else
+            {
+                i++;
             }
         }
+
+        if (dirty.count == dirty.capacity)
+        {
+            for (u32 i = 0; i < dirty.count; i++)
+            {
+                merged = bounding_box(dirty.rects[i], merged);
+            }
+
+            dirty.count = 0;
+        }
+
+        dirty.rects[dirty.count++] = merged;
+    }
+
+
+    bool is_dirty(DirtyRects const& dirty, Rect2Du32 const& rect)
+    {
+        for (u32 i = 0; i < dirty.count; i++)
+        {
+            if (overlaps(dirty.rects[i], rect))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+
+    bool intersect(Rect2Du32 const& a, Rect2Du32 const& b, Rect2Du32& result)
+    {
+        result.x_begin = std::max(a.x_begin, b.x_begin);
+        result.x_end = std::min(a.x_end, b.x_end);
+        result.y_begin = std::max(a.y_begin, b.y_begin);
+        result.y_end = std::min(a.y_end, b.y_end);
+
+        return !is_empty(result);
+    }
+
+
+    void fill(ImageView const& view, Pixel color, DirtyRects const& dirty)
+    {
+        Rect2Du32 bounds{};
+        bounds.x_begin = 0;
+        bounds.x_end = view.width;
+        bounds.y_begin = 0;
+        bounds.y_end = view.height;
+
+        for (u32 i = 0; i < dirty.count; i++)
+        {
+            Rect2Du32 clip{};
+            if (intersect(dirty.rects[i], bounds, clip))
+            {
+                fill_parallel(sub_view(view, clip), color);
+            }
+        }
+    }
+
+
+    void transform_palette(GrayView const& src, SubView const& dst, Palette const& palette, u8 transparent_index, DirtyRects const& dirty)
+    {
+        for_each_dirty(src, dst, dirty, [&](GraySubView const& src_part, SubView const& dst_part)
+        {
+            transform_palette_parallel(src_part, dst_part, palette, transparent_index);
+        });
+    }
+
+
+    void transform_palette(GraySubView const& src, SubView const& dst, Palette const& palette, u8 transparent_index, DirtyRects const& dirty)
+    {
+        for_each_dirty(src, dst, dirty, [&](GraySubView const& src_part, SubView const& dst_part)
+        {
+            transform_palette_parallel(src_part, dst_part, palette, transparent_index);
+        });
     }
 }
 
@@ -278,6 +494,21 @@ namespace image
     }
 
 
+    void begin_decode(Arena& arena)
+    {
+        stb_image_alloc::set_decode_arena(&arena);
+    }
+
+
+    u32 end_decode()
+    {
+        auto const high_water = stb_image_alloc::decode_high_water();
+        stb_image_alloc::set_decode_arena(nullptr);
+
+        return high_water;
+    }
+
+
     bool read_image_from_file(const char* img_path_src, Image& image_dst)
 	{
         auto is_valid_file = is_valid_image_file(img_path_src);
@@ -310,4 +541,99 @@ namespace image
 
 		return true;
 	}
-}
\ No newline at end of file
+
+    bool read_image_size(const char* img_path_src, u32& width, u32& height)
+    {
+        int w = 0;
+        int h = 0;
+        int channels = 0;
+
+        if (!is_valid_image_file(img_path_src) || !stbi_info(img_path_src, &w, &h, &channels))
+        {
+            return false;
+        }
+
+        width = (u32)w;
+        height = (u32)h;
+
+        return true;
+    }
+
+
+    static void transform_mask(Image const& image, u32 scale, fn<u8(Pixel)> const& func, GrayView const& mask_dst)
+    {
+        if (scale == 1)
+        {
+            transform(make_view(image), mask_dst, func);
+        }
+        else
+        {
+            transform_scale_up(make_view(image), mask_dst, scale, func);
+        }
+    }
+
+
+    static void free_decoded(Arena* arena, mb::ArenaMarker const& marker, Image const& image)
+    {
+        if (arena)
+        {
+            mb::restore_marker(*arena, marker);
+        }
+        else
+        {
+            stbi_image_free(image.data_);
+        }
+    }
+
+
+    bool read_image_then_transform(const char* img_path_src, Buffer8& buffer, u32 scale, fn<u8(Pixel)> const& func, GrayView& mask_dst)
+    {
+        assert(scale);
+
+        auto arena = stb_image_alloc::decode_arena();
+        auto const marker = arena ? mb::save_marker(*arena) : mb::ArenaMarker{};
+
+        Image image{};
+        if (!read_image_from_file(img_path_src, image))
+        {
+            return false;
+        }
+
+        mask_dst = make_view(image.width * scale, image.height * scale, buffer);
+
+        auto const ok = mask_dst.matrix_data_ != nullptr;
+        if (ok)
+        {
+            transform_mask(image, scale, func, mask_dst);
+        }
+
+        free_decoded(arena, marker, image);
+
+        return ok;
+    }
+
+
+    bool read_image_then_transform(const char* img_path_src, u32 scale, fn<u8(Pixel)> const& func, GrayView const& mask_dst)
+    {
+        assert(scale);
+
+        auto arena = stb_image_alloc::decode_arena();
+        auto const marker = arena ? mb::save_marker(*arena) : mb::ArenaMarker{};
+
+        Image image{};
+        if (!read_image_from_file(img_path_src, image))
+        {
+            return false;
+        }
+
+        auto const ok = mask_dst.matrix_data_ && mask_dst.width == image.width * scale && mask_dst.height == image.height * scale;
+        if (ok)
+        {
+            transform_mask(image, scale, func, mask_dst);
+        }
+
+        free_decoded(arena, marker, image);
+
+        return ok;
+    }
+}
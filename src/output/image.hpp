@@ -48,6 +48,15 @@ namespace image
     using Buffer8 = MemoryBuffer<u8>;
 
 
+    class Palette
+    {
+    public:
+        static constexpr u32 count = 256;
+
+        Pixel colors[count];
+    };
+
+
     constexpr inline Pixel to_pixel(u8 red, u8 green, u8 blue, u8 alpha)
     {
         Pixel p{};
@@ -91,10 +100,61 @@ namespace image
 {
     ImageView make_view(Image const& image);
 
+    // the view is aligned to mb::SIMD_ALIGNMENT, size the buffer with mb::aligned_size
     GrayView make_view(u32 width, u32 height, Buffer8& buffer);
 }
 
 
+/* row_begin */
+
+namespace image
+{
+    template <typename T>
+	inline SpanView<T> row_begin(MatrixView2D<T> const& view, u32 y)
+	{
+        SpanView<T> span{};
+
+        span.begin = view.matrix_data_ + (u64)y * view.matrix_width;
+        span.length = view.width;
+
+        return span;
+	}
+
+
+    template <typename T>
+    inline SpanView<T> row_begin(MatrixSubView2D<T> const& view, u32 y)
+    {
+        SpanView<T> span{};
+
+        span.begin = view.matrix_data_ + (u64)((view.y_begin + y) * view.matrix_width + view.x_begin);
+        span.length = view.width;
+
+        return span;
+    }
+
+
+    template <typename T>
+    inline bool is_contiguous(MatrixView2D<T> const& view)
+    {
+        return view.matrix_width == view.width;
+    }
+
+
+    template <typename T>
+    inline SpanView<T> to_span(MatrixView2D<T> const& view)
+    {
+        assert(is_contiguous(view));
+
+        SpanView<T> span{};
+
+        span.begin = view.matrix_data_;
+        span.length = view.width * view.height;
+
+        return span;
+    }
+}
+
+
 /* sub_view */
 
 namespace image
@@ -105,7 +165,7 @@ namespace image
         MatrixSubView2D<T> sub_view{};
 
         sub_view.matrix_data_ = view.matrix_data_;
-        sub_view.matrix_width = view.width;
+        sub_view.matrix_width = view.matrix_width;
         sub_view.range = range;
         sub_view.width = range.x_end - range.x_begin;
         sub_view.height = range.y_end - range.y_begin;
@@ -135,6 +195,16 @@ namespace image
 }
 
 
+/* simd */
+
+namespace image
+{
+    // span kernels are selected once at startup from the cpu features
+    // define IMAGE_NO_SIMD to force the scalar versions
+    cstr simd_name();
+}
+
+
 /* fill */
 
 namespace image
@@ -144,6 +214,28 @@ namespace image
     void fill(SubView const& view, Pixel color);
 
     void fill_if(GraySubView const& view, u8 gray, fn<bool(u8)> const& pred);
+
+
+    template <class PRED>
+    inline void fill_span_if(SpanView<u8> const& dst, u8 value, PRED const& pred)
+    {
+        auto d = dst.begin;
+
+        for (u32 i = 0; i < dst.length; ++i)
+		{
+			d[i] = pred(d[i]) ? value : d[i];
+		}
+    }
+
+
+    template <class PRED>
+    inline void fill_if(GraySubView const& view, u8 gray, PRED const& pred)
+    {
+        for (u32 y = 0; y < view.height; y++)
+        {
+            fill_span_if(row_begin(view, y), gray, pred);
+        }
+    }
 }
 
 
@@ -158,6 +250,272 @@ namespace image
     void transform(ImageView const& src, GrayView const& dst, fn<u8(Pixel)> const& func);
 
     void transform_scale_up(ImageView const& src, GrayView const& dst, u32 scale, fn<u8(Pixel)> const& func);
+
+
+    template <class FUNC>
+    inline void transform_span(SpanView<u8> const& src, SpanView<Pixel> const& dst, FUNC const& func)
+    {
+        auto s = src.begin;
+        auto d = dst.begin;
+
+        for (u32 i = 0; i < src.length; i++)
+        {
+            d[i] = func(s[i], d[i]);
+        }
+    }
+
+
+    template <class FUNC>
+    inline void transform_span(SpanView<Pixel> const& src, SpanView<u8> const& dst, FUNC const& func)
+    {
+        auto s = src.begin;
+        auto d = dst.begin;
+
+        for (u32 i = 0; i < src.length; i++)
+        {
+            d[i] = func(s[i]);
+        }
+    }
+
+
+    template <class FUNC>
+    inline void transform(GrayView const& src, SubView const& dst, FUNC const& func)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        for (u32 y = 0; y < src.height; y++)
+        {
+            transform_span(row_begin(src, y), row_begin(dst, y), func);
+        }
+    }
+
+
+    template <class FUNC>
+    inline void transform(GraySubView const& src, SubView const& dst, FUNC const& func)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        for (u32 y = 0; y < src.height; y++)
+        {
+            transform_span(row_begin(src, y), row_begin(dst, y), func);
+        }
+    }
+
+
+    template <class FUNC>
+    inline void transform(ImageView const& src, GrayView const& dst, FUNC const& func)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width);
+        assert(dst.height == src.height);
+
+        if (is_contiguous(src) && is_contiguous(dst))
+        {
+            transform_span(to_span(src), to_span(dst), func);
+            return;
+        }
+
+        for (u32 y = 0; y < src.height; y++)
+        {
+            transform_span(row_begin(src, y), row_begin(dst, y), func);
+        }
+    }
+
+
+    template <class FUNC>
+    inline void transform_scale_up(ImageView const& src, GrayView const& dst, u32 scale, FUNC const& func)
+    {
+        assert(src.matrix_data_);
+        assert(dst.matrix_data_);
+        assert(dst.width == src.width * scale);
+        assert(dst.height == src.height * scale);
+
+        for (u32 src_y = 0; src_y < src.height; src_y++)
+        {
+            auto src_row = row_begin(src, src_y);
+
+            // expand the first destination row, then copy it down
+            auto dst_y = src_y * scale;
+            auto dst_row = row_begin(dst, dst_y);
+
+            for (u32 src_x = 0; src_x < src.width; src_x++)
+            {
+                auto const value = func(src_row.begin[src_x]);
+
+                auto d = dst_row.begin + src_x * scale;
+                for (u32 offset_x = 0; offset_x < scale; offset_x++)
+                {
+                    d[offset_x] = value;
+                }
+            }
+
+            for (u32 offset_y = 1; offset_y < scale; offset_y++)
+            {
+                auto copy_row = row_begin(dst, dst_y + offset_y);
+                for (u32 x = 0; x < dst.width; x++)
+                {
+                    copy_row.begin[x] = dst_row.begin[x];
+                }
+            }
+        }
+    }
+}
+
+
+/* copy */
+
+namespace image
+{
+    void copy(ImageView const& src, ImageView const& dst);
+
+    void copy(ImageView const& src, SubView const& dst);
+
+    void copy(SubView const& src, SubView const& dst);
+}
+
+
+/* palette */
+
+namespace image
+{
+    // dst = palette[src] except where src == transparent_index
+    void transform_palette(GrayView const& src, SubView const& dst, Palette const& palette, u8 transparent_index);
+
+    void transform_palette(GraySubView const& src, SubView const& dst, Palette const& palette, u8 transparent_index);
+}
+
+
+/* parallel */
+
+namespace image
+{
+    // views with fewer than min_pixels are processed on the calling thread
+    bool init_parallel(u32 n_workers, u32 min_pixels);
+
+    void close_parallel();
+
+    // calls band(y_begin, y_end) for horizontal bands covering [0, height)
+    void process_row_bands(u32 width, u32 height, fn<void(u32, u32)> const& band);
+
+
+    template <typename T>
+    inline MatrixView2D<T> row_band(MatrixView2D<T> const& view, u32 y_begin, u32 y_end)
+    {
+        MatrixView2D<T> band = view;
+
+        band.matrix_data_ = row_begin(view, y_begin).begin;
+        band.height = y_end - y_begin;
+
+        return band;
+    }
+
+
+    template <typename T>
+    inline MatrixSubView2D<T> row_band(MatrixSubView2D<T> const& view, u32 y_begin, u32 y_end)
+    {
+        Rect2Du32 range{};
+        range.x_begin = 0;
+        range.x_end = view.width;
+        range.y_begin = y_begin;
+        range.y_end = y_end;
+
+        return sub_view(view, range);
+    }
+
+
+    void fill_parallel(ImageView const& view, Pixel color);
+
+    void fill_parallel(SubView const& view, Pixel color);
+
+
+    template <class SRC, class FUNC>
+    inline void transform_parallel(SRC const& src, SubView const& dst, FUNC const& func)
+    {
+        process_row_bands(src.width, src.height, [&](u32 y_begin, u32 y_end)
+        {
+            transform(row_band(src, y_begin, y_end), row_band(dst, y_begin, y_end), func);
+        });
+    }
+
+
+    template <class FUNC>
+    inline void transform_scale_up_parallel(ImageView const& src, GrayView const& dst, u32 scale, FUNC const& func)
+    {
+        process_row_bands(dst.width, src.height, [&](u32 y_begin, u32 y_end)
+        {
+            transform_scale_up(row_band(src, y_begin, y_end), row_band(dst, y_begin * scale, y_end * scale), scale, func);
+        });
+    }
+
+
+    template <class SRC>
+    inline void transform_palette_parallel(SRC const& src, SubView const& dst, Palette const& palette, u8 transparent_index)
+    {
+        process_row_bands(src.width, src.height, [&](u32 y_begin, u32 y_end)
+        {
+            transform_palette(row_band(src, y_begin, y_end), row_band(dst, y_begin, y_end), palette, transparent_index);
+        });
+    }
+}
+
+
+/* damage */
+
+namespace image
+{
+    bool is_dirty(DirtyRects const& dirty, Rect2Du32 const& rect);
+
+    bool intersect(Rect2Du32 const& a, Rect2Du32 const& b, Rect2Du32& result);
+
+
+    // calls func(src_part, dst_part) for each part of dst covered by a dirty rect
+    // dirty rects are in the coordinates of the matrix that dst views
+    template <class SRC, class FUNC>
+    inline void for_each_dirty(SRC const& src, SubView const& dst, DirtyRects const& dirty, FUNC const& func)
+    {
+        for (u32 i = 0; i < dirty.count; i++)
+        {
+            Rect2Du32 clip{};
+            if (!intersect(dirty.rects[i], dst.range, clip))
+            {
+                continue;
+            }
+
+            Rect2Du32 local{};
+            local.x_begin = clip.x_begin - dst.x_begin;
+            local.x_end = clip.x_end - dst.x_begin;
+            local.y_begin = clip.y_begin - dst.y_begin;
+            local.y_end = clip.y_end - dst.y_begin;
+
+            func(sub_view(src, local), sub_view(dst, local));
+        }
+    }
+
+
+    // dirty parts are processed with the row band pool
+
+    void fill(ImageView const& view, Pixel color, DirtyRects const& dirty);
+
+    void transform_palette(GrayView const& src, SubView const& dst, Palette const& palette, u8 transparent_index, DirtyRects const& dirty);
+
+    void transform_palette(GraySubView const& src, SubView const& dst, Palette const& palette, u8 transparent_index, DirtyRects const& dirty);
+
+
+    template <class SRC, class FUNC>
+    inline void transform(SRC const& src, SubView const& dst, FUNC const& func, DirtyRects const& dirty)
+    {
+        for_each_dirty(src, dst, dirty, [&](auto const& src_part, SubView const& dst_part)
+        {
+            transform_parallel(src_part, dst_part, func);
+        });
+    }
 }
 
 
@@ -165,5 +523,23 @@ namespace image
 
 namespace image
 {
+    // stb_image allocations on this thread come from arena until end_decode
+    // images read in between live in the arena, release it rather than destroy_image them
+    void begin_decode(Arena& arena);
+
+    // returns the most arena bytes in use at once while decoding
+    u32 end_decode();
+
     bool read_image_from_file(const char* img_path_src, Image& image_dst);
+
+    // the size in the file header, nothing is decoded
+    bool read_image_size(const char* img_path_src, u32& width, u32& height);
+
+    // decodes the whole image to rgba, then transforms it into a scale times larger mask pushed on buffer
+    // the rgba image is freed before returning, with a decode arena the arena is rewound and the next image reuses its memory
+    bool read_image_then_transform(const char* img_path_src, Buffer8& buffer, u32 scale, fn<u8(Pixel)> const& func, GrayView& mask_dst);
+
+    // the same into a mask made beforehand, scale times the image size
+    // threads decoding at once each need their own decode arena
+    bool read_image_then_transform(const char* img_path_src, u32 scale, fn<u8(Pixel)> const& func, GrayView const& mask_dst);
 }
\ No newline at end of file
@@ -0,0 +1,407 @@
+#pragma once
+
+/* span kernels used by image.cpp */
+
+#include "output.hpp"
+
+#include <cstring>
+
+#ifndef IMAGE_NO_SIMD
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+
+#define IMAGE_SIMD_X86
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+
+#define IMAGE_SIMD_NEON
+#include <arm_neon.h>
+
+#endif
+
+#endif // IMAGE_NO_SIMD
+
+
+#if defined(__GNUC__) || defined(__clang__)
+#define IMAGE_TARGET_SSE2 __attribute__((target("sse2")))
+#define IMAGE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define IMAGE_TARGET_SSE2
+#define IMAGE_TARGET_AVX2
+#endif
+
+
+namespace simd
+{
+    using Pixel = image::Pixel;
+
+
+    class SpanKernels
+    {
+    public:
+        void (*fill)(Pixel* dst, u32 length, Pixel value) = nullptr;
+        void (*copy)(Pixel const* src, Pixel* dst, u32 length) = nullptr;
+        void (*palette)(u8 const* src, Pixel* dst, u32 length, Pixel const* palette, u8 transparent) = nullptr;
+
+        cstr name = "";
+    };
+}
+
+
+/* scalar */
+
+namespace simd
+{
+    static void fill_scalar(Pixel* dst, u32 length, Pixel value)
+    {
+        for (u32 i = 0; i < length; i++)
+        {
+            dst[i] = value;
+        }
+    }
+
+
+    static void copy_scalar(Pixel const* src, Pixel* dst, u32 length)
+    {
+        std::memcpy(dst, src, (size_t)length * sizeof(Pixel));
+    }
+
+
+    static void palette_scalar(u8 const* src, Pixel* dst, u32 length, Pixel const* palette, u8 transparent)
+    {
+        for (u32 i = 0; i < length; i++)
+        {
+            auto const id = src[i];
+            dst[i] = id == transparent ? dst[i] : palette[id];
+        }
+    }
+}
+
+
+#ifdef IMAGE_SIMD_X86
+
+/* sse2 */
+
+namespace simd
+{
+    static inline u32 to_u32(Pixel p)
+    {
+        u32 value;
+        std::memcpy(&value, &p, sizeof(value));
+        return value;
+    }
+
+
+    IMAGE_TARGET_SSE2
+    static void fill_sse2(Pixel* dst, u32 length, Pixel value)
+    {
+        constexpr u32 N = 4;
+
+        auto const v = _mm_set1_epi32((int)to_u32(value));
+
+        u32 i = 0;
+        for (; i + N <= length; i += N)
+        {
+            _mm_storeu_si128((__m128i*)(dst + i), v);
+        }
+
+        fill_scalar(dst + i, length - i, value);
+    }
+
+
+    IMAGE_TARGET_SSE2
+    static void copy_sse2(Pixel const* src, Pixel* dst, u32 length)
+    {
+        constexpr u32 N = 4;
+
+        u32 i = 0;
+        for (; i + N <= length; i += N)
+        {
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_loadu_si128((__m128i const*)(src + i)));
+        }
+
+        copy_scalar(src + i, dst + i, length - i);
+    }
+
+
+    IMAGE_TARGET_SSE2
+    static void palette_sse2(u8 const* src, Pixel* dst, u32 length, Pixel const* palette, u8 transparent)
+    {
+        constexpr u32 N = 4;
+
+        auto const key = _mm_set1_epi32(transparent);
+
+        u32 i = 0;
+        for (; i + N <= length; i += N)
+        {
+            auto const s = src + i;
+
+            // no gather in sse2
+            auto const colors = _mm_setr_epi32(
+                (int)to_u32(palette[s[0]]), 
+                (int)to_u32(palette[s[1]]), 
+                (int)to_u32(palette[s[2]]), 
+                (int)to_u32(palette[s[3]]));
+
+            auto const ids = _mm_setr_epi32(s[0], s[1], s[2], s[3]);
+            auto const keep = _mm_cmpeq_epi32(ids, key);
+
+            auto d = (__m128i*)(dst + i);
+            auto const old = _mm_loadu_si128(d);
+
+            _mm_storeu_si128(d, _mm_or_si128(_mm_and_si128(keep, old), _mm_andnot_si128(keep, colors)));
+        }
+
+        palette_scalar(src + i, dst + i, length - i, palette, transparent);
+    }
+}
+
+
+/* avx2 */
+
+namespace simd
+{
+    IMAGE_TARGET_AVX2
+    static void fill_avx2(Pixel* dst, u32 length, Pixel value)
+    {
+        constexpr u32 N = 8;
+
+        auto const v = _mm256_set1_epi32((int)to_u32(value));
+
+        u32 i = 0;
+        for (; i + N <= length; i += N)
+        {
+            _mm256_storeu_si256((__m256i*)(dst + i), v);
+        }
+
+        fill_scalar(dst + i, length - i, value);
+    }
+
+
+    IMAGE_TARGET_AVX2
+    static void copy_avx2(Pixel const* src, Pixel* dst, u32 length)
+    {
+        constexpr u32 N = 8;
+
+        u32 i = 0;
+        for (; i + N <= length; i += N)
+        {
+            _mm256_storeu_si256((__m256i*)(dst + i), _mm256_loadu_si256((__m256i const*)(src + i)));
+        }
+
+        copy_scalar(src + i, dst + i, length - i);
+    }
+
+
+    IMAGE_TARGET_AVX2
+    static void palette_avx2(u8 const* src, Pixel* dst, u32 length, Pixel const* palette, u8 transparent)
+    {
+        constexpr u32 N = 8;
+
+        auto const key = _mm256_set1_epi32(transparent);
+        auto const ones = _mm256_set1_epi32(-1);
+
+        u32 i = 0;
+        for (; i + N <= length; i += N)
+        {
+            auto const ids = _mm256_cvtepu8_epi32(_mm_loadl_epi64((__m128i const*)(src + i)));
+            auto const colors = _mm256_i32gather_epi32((int const*)palette, ids, 4);
+
+            // write only where the id is not the transparent key
+            auto const write = _mm256_xor_si256(_mm256_cmpeq_epi32(ids, key), ones);
+
+            _mm256_maskstore_epi32((int*)(dst + i), write, colors);
+        }
+
+        palette_scalar(src + i, dst + i, length - i, palette, transparent);
+    }
+}
+
+
+/* cpu */
+
+namespace simd
+{
+    static bool cpu_has_avx2()
+    {
+#ifdef _MSC_VER
+
+        int info[4] = { 0 };
+
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+
+        __cpuid(info, 1);
+        auto const os_xsave = (info[2] & (1 << 27)) != 0;
+        auto const has_avx = (info[2] & (1 << 28)) != 0;
+        if (!os_xsave || !has_avx || (_xgetbv(0) & 6) != 6)
+        {
+            return false;
+        }
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+
+#else
+
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+
+#endif
+    }
+
+
+    static bool cpu_has_sse2()
+    {
+#if defined(__x86_64__) || defined(_M_X64)
+
+        return true;
+
+#elif defined(_MSC_VER)
+
+        int info[4] = { 0 };
+        __cpuid(info, 1);
+        return (info[3] & (1 << 26)) != 0;
+
+#else
+
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2");
+
+#endif
+    }
+}
+
+#endif // IMAGE_SIMD_X86
+
+
+#ifdef IMAGE_SIMD_NEON
+
+/* neon */
+
+namespace simd
+{
+    static void fill_neon(Pixel* dst, u32 length, Pixel value)
+    {
+        constexpr u32 N = 4;
+
+        u32 value_u32;
+        std::memcpy(&value_u32, &value, sizeof(value_u32));
+
+        auto const v = vdupq_n_u32(value_u32);
+
+        u32 i = 0;
+        for (; i + N <= length; i += N)
+        {
+            vst1q_u32((uint32_t*)(dst + i), v);
+        }
+
+        fill_scalar(dst + i, length - i, value);
+    }
+
+
+    static void copy_neon(Pixel const* src, Pixel* dst, u32 length)
+    {
+        constexpr u32 N = 4;
+
+        u32 i = 0;
+        for (; i + N <= length; i += N)
+        {
+            vst1q_u8((uint8_t*)(dst + i), vld1q_u8((uint8_t const*)(src + i)));
+        }
+
+        copy_scalar(src + i, dst + i, length - i);
+    }
+
+
+    static void palette_neon(u8 const* src, Pixel* dst, u32 length, Pixel const* palette, u8 transparent)
+    {
+        constexpr u32 N = 4;
+
+        auto const key = vdupq_n_u32(transparent);
+
+        u32 i = 0;
+        for (; i + N <= length; i += N)
+        {
+            auto const s = src + i;
+
+            uint32_t lookup[N];
+            std::memcpy(lookup + 0, palette + s[0], sizeof(u32));
+            std::memcpy(lookup + 1, palette + s[1], sizeof(u32));
+            std::memcpy(lookup + 2, palette + s[2], sizeof(u32));
+            std::memcpy(lookup + 3, palette + s[3], sizeof(u32));
+
+            uint32_t id_list[N] = { s[0], s[1], s[2], s[3] };
+
+            auto const keep = vceqq_u32(vld1q_u32(id_list), key);
+
+            auto d = (uint32_t*)(dst + i);
+            vst1q_u32(d, vbslq_u32(keep, vld1q_u32(d), vld1q_u32(lookup)));
+        }
+
+        palette_scalar(src + i, dst + i, length - i, palette, transparent);
+    }
+}
+
+#endif // IMAGE_SIMD_NEON
+
+
+/* dispatch */
+
+namespace simd
+{
+    static SpanKernels scalar_kernels()
+    {
+        SpanKernels k{};
+
+        k.fill = fill_scalar;
+        k.copy = copy_scalar;
+        k.palette = palette_scalar;
+        k.name = "scalar";
+
+        return k;
+    }
+
+
+    // called once at startup
+    static SpanKernels select_kernels()
+    {
+        auto k = scalar_kernels();
+
+#if defined(IMAGE_SIMD_X86)
+
+        if (cpu_has_avx2())
+        {
+            k.fill = fill_avx2;
+            k.copy = copy_avx2;
+            k.palette = palette_avx2;
+            k.name = "avx2";
+        }
+        else if (cpu_has_sse2())
+        {
+            k.fill = fill_sse2;
+            k.copy = copy_sse2;
+            k.palette = palette_sse2;
+            k.name = "sse2";
+        }
+
+#elif defined(IMAGE_SIMD_NEON)
+
+        k.fill = fill_neon;
+        k.copy = copy_neon;
+        k.palette = palette_neon;
+        k.name = "neon";
+
+#endif
+
+        return k;
+    }
+}
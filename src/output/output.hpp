@@ -23,6 +23,24 @@ namespace image
     using GrayView = MatrixView2D<u8>;
 
 
+    // regions of an image that changed, merged so they do not overlap
+    class DirtyRects
+    {
+    public:
+        static constexpr u32 capacity = 16;
+
+        Rect2Du32 rects[capacity];
+
+        u32 count = 0;
+    };
+
+
+    void clear_dirty(DirtyRects& dirty);
+
+    // overlapping rects are merged, a full list collapses to its bounding box
+    void mark_dirty(DirtyRects& dirty, Rect2Du32 const& rect);
+
+
     bool create_image(Image& image, u32 width, u32 height);
 
     void destroy_image(Image& image);
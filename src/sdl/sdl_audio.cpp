@@ -1,5 +1,6 @@
 #include "sdl_include.hpp"
 #include "../output/audio.hpp"
+#include "../util/startup_timer.hpp"
 
 #include <SDL2/SDL_mixer.h>
 #include <cstring>
@@ -109,15 +110,24 @@ namespace audio
 
     bool init_audio()
     {
-        Mix_Init(MIX_INIT_MP3 | MIX_INIT_OGG);
-	    SDL_Init(SDL_INIT_AUDIO);
+        {
+            STARTUP_PHASE("Mix_Init");
+
+            Mix_Init(MIX_INIT_MP3 | MIX_INIT_OGG);
+            SDL_Init(SDL_INIT_AUDIO);
+        }
 
         int const freq = 44100;
         auto const format = MIX_DEFAULT_FORMAT;
         int const channels = 1;
         int const chunk_size = 2048;
 
-        auto rc = Mix_OpenAudio(freq, format, channels, chunk_size);
+        int rc = 0;
+        {
+            STARTUP_PHASE("Mix_OpenAudio");
+            rc = Mix_OpenAudio(freq, format, channels, chunk_size);
+        }
+
         if (rc < 0)
         {
             print_message(Mix_GetError());
@@ -187,6 +197,53 @@ namespace audio
     }
 
 
+    bool load_sound_from_memory(u8 const* bytes, u32 n_bytes, Sound& sound)
+    {
+        auto rw = SDL_RWFromConstMem(bytes, (int)n_bytes);
+        if (!rw)
+        {
+            return false;
+        }
+
+        // closes rw
+        sound_p data = Mix_LoadWAV_RW(rw, 1);
+        if (!data)
+        {
+            return false;
+        }
+
+        sound.data_ = (void*)data;
+
+        sound.is_on = false;
+
+        return true;
+    }
+
+
+    bool load_music_from_memory(u8 const* bytes, u32 n_bytes, Music& music)
+    {
+        auto rw = SDL_RWFromConstMem(bytes, (int)n_bytes);
+        if (!rw)
+        {
+            return false;
+        }
+
+        // rw is closed with the music
+        music_p data = Mix_LoadMUS_RW(rw, 1);
+        if (!data)
+        {
+            return false;
+        }
+
+        music.data_ = (void*)data;
+
+        music.is_on = false;
+        music.is_paused = false;
+
+        return true;
+    }
+
+
     f32 set_music_volume(f32 volume)
     {
         constexpr int MAX = MIX_MAX_VOLUME;
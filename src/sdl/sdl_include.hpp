@@ -2,6 +2,7 @@
 
 #include "../input/input.hpp"
 #include "../output/output.hpp"
+#include "../util/hash.hpp"
 
 
 #if defined(_WIN32)
@@ -10,6 +11,10 @@
 
 #include <SDL2/SDL.h>
 
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
 #ifndef NDEBUG
 #define PRINT_MESSAGES
 #endif
@@ -255,6 +260,38 @@ namespace sdl
 
 namespace sdl
 {
+    enum class UploadMode : u8
+    {
+        // whole screen every frame
+        Full,
+
+        // rects the app reports as changed
+        DirtyRects,
+
+        // tiles whose hash changed since the last upload
+        Tiles,
+
+        // app renders into the locked texture, nothing is uploaded
+        Locked
+    };
+
+
+    constexpr u32 UPLOAD_TILE_SIZE = 64;
+
+
+    enum class Presenter : u8
+    {
+        // accelerated renderer if there is one, otherwise the window surface
+        Auto,
+
+        // streaming texture drawn with SDL_Renderer
+        Renderer,
+
+        // window surface, scaled on the cpu
+        WindowSurface
+    };
+
+
     class ScreenMemory
     {
     public:
@@ -263,7 +300,28 @@ namespace sdl
         SDL_Renderer* renderer = nullptr;
         SDL_Texture* texture = nullptr;
 
+        // owned by the window, replaced when the window is resized
+        SDL_Surface* surface = nullptr;
+        u32 surface_width = 0;
+        u32 surface_height = 0;
+        u32 surface_scale = 0;
+        u32 surface_x = 0;
+        u32 surface_y = 0;
+
         image::Image image;
+
+        Presenter presenter = Presenter::Auto;
+        UploadMode upload_mode = UploadMode::Full;
+
+        u64* tile_hashes = nullptr;
+        u32 tiles_x = 0;
+        u32 tiles_y = 0;
+        b32 tiles_valid = 0;
+
+        // bytes sent with SDL_UpdateTexture by the last render_screen
+        u64 upload_bytes = 0;
+
+        b32 is_locked = 0;
     };
 
 
@@ -274,6 +332,12 @@ namespace sdl
             image::destroy_image(screen.image);
         }
 
+        if (screen.tile_hashes)
+        {
+            std::free(screen.tile_hashes);
+            screen.tile_hashes = nullptr;
+        }
+
         if (screen.texture)
         {
             SDL_DestroyTexture(screen.texture);
@@ -329,6 +393,36 @@ namespace sdl
         }
 
 
+        static bool create_window_surface(ScreenMemory& screen)
+        {
+            screen.surface = SDL_GetWindowSurface(screen.window);
+            if (!screen.surface)
+            {
+                display_error("SDL_GetWindowSurface failed");
+                return false;
+            }
+
+            if (screen.surface->format->BytesPerPixel != 4)
+            {
+                display_error("Window surface is not 32 bit");
+                return false;
+            }
+
+            // surfaces get no memory to lock
+            if (screen.upload_mode == UploadMode::Locked)
+            {
+                print_message("UploadMode::Locked needs a renderer, using UploadMode::Full");
+                screen.upload_mode = UploadMode::Full;
+            }
+
+            // sized on the first present
+            screen.surface_width = 0;
+            screen.surface_height = 0;
+
+            return true;
+        }
+
+
         static bool create_texture(ScreenMemory& screen, u32 width, u32 height)
         {
             screen.texture =  SDL_CreateTexture(
@@ -348,8 +442,44 @@ namespace sdl
         }
 
 
+        static bool create_presenter(ScreenMemory& screen, u32 width, u32 height)
+        {
+            switch (screen.presenter)
+            {
+            case Presenter::Auto:
+                screen.renderer = SDL_CreateRenderer(screen.window, -1, SDL_RENDERER_ACCELERATED);
+                if (screen.renderer)
+                {
+                    screen.presenter = Presenter::Renderer;
+                    return create_texture(screen, width, height);
+                }
+
+                print_message("No accelerated renderer, using the window surface");
+                screen.presenter = Presenter::WindowSurface;
+                return create_window_surface(screen);
+
+            case Presenter::Renderer:
+                return create_renderer(screen) && create_texture(screen, width, height);
+
+            case Presenter::WindowSurface:
+                return create_window_surface(screen);
+            }
+
+            return false;
+        }
+
+
         static bool create_image(ScreenMemory& screen, u32 width, u32 height)
         {
+            if (screen.upload_mode == UploadMode::Locked)
+            {
+                // pixels come from SDL_LockTexture each frame
+                screen.image.data_ = nullptr;
+                screen.image.width = width;
+                screen.image.height = height;
+                return true;
+            }
+
             if(!image::create_image(screen.image, width, height))
             {
                 display_error("Allocating image memory failed");
@@ -361,6 +491,28 @@ namespace sdl
 
             return true;
         }
+
+
+        static bool create_tile_hashes(ScreenMemory& screen, u32 width, u32 height)
+        {
+            if (screen.upload_mode != UploadMode::Tiles)
+            {
+                return true;
+            }
+
+            screen.tiles_x = (width + UPLOAD_TILE_SIZE - 1) / UPLOAD_TILE_SIZE;
+            screen.tiles_y = (height + UPLOAD_TILE_SIZE - 1) / UPLOAD_TILE_SIZE;
+            screen.tiles_valid = 0;
+
+            screen.tile_hashes = (u64*)std::malloc(sizeof(u64) * screen.tiles_x * screen.tiles_y);
+            if (!screen.tile_hashes)
+            {
+                display_error("Allocating tile memory failed");
+                return false;
+            }
+
+            return true;
+        }
     }
 
 
@@ -374,19 +526,19 @@ namespace sdl
             return false;
         }
         
-        if (!screen::create_renderer(screen))
+        if (!screen::create_presenter(screen, width, height))
         {
             destroy_screen_memory(screen);
             return false;
         }
 
-        if (!screen::create_texture(screen, width, height))
+        if (!screen::create_image(screen, width, height))
         {
             destroy_screen_memory(screen);
             return false;
         }
 
-        if (!screen::create_image(screen, width, height))
+        if (!screen::create_tile_hashes(screen, width, height))
         {
             destroy_screen_memory(screen);
             return false;
@@ -406,19 +558,19 @@ namespace sdl
             return false;
         }
         
-        if (!screen::create_renderer(screen))
+        if (!screen::create_presenter(screen, screen_dim.x, screen_dim.y))
         {
             destroy_screen_memory(screen);
             return false;
         }
 
-        if (!screen::create_texture(screen, screen_dim.x, screen_dim.y))
+        if (!screen::create_image(screen, screen_dim.x, screen_dim.y))
         {
             destroy_screen_memory(screen);
             return false;
         }
 
-        if (!screen::create_image(screen, screen_dim.x, screen_dim.y))
+        if (!screen::create_tile_hashes(screen, screen_dim.x, screen_dim.y))
         {
             destroy_screen_memory(screen);
             return false;
@@ -428,16 +580,178 @@ namespace sdl
     }
 
 
-    static void render_screen(ScreenMemory const& screen)
+    static void update_texture_rect(ScreenMemory& screen, Rect2Du32 const& range)
+    {
+        auto const width = range.x_end - range.x_begin;
+        auto const height = range.y_end - range.y_begin;
+
+        SDL_Rect rect{};
+        rect.x = (int)range.x_begin;
+        rect.y = (int)range.y_begin;
+        rect.w = (int)width;
+        rect.h = (int)height;
+
+        auto const pitch = screen.image.width * SCREEN_BYTES_PER_PIXEL;
+        auto const pixels = screen.image.data_ + (u64)range.y_begin * screen.image.width + range.x_begin;
+
+        auto error = SDL_UpdateTexture(screen.texture, &rect, (void*)pixels, pitch);
+        if(error)
+        {
+            print_error("SDL_UpdateTexture failed");
+            return;
+        }
+
+        screen.upload_bytes += (u64)width * height * SCREEN_BYTES_PER_PIXEL;
+    }
+
+
+    static void update_texture_full(ScreenMemory& screen)
     {
         auto const pitch = screen.image.width * SCREEN_BYTES_PER_PIXEL;
         auto error = SDL_UpdateTexture(screen.texture, 0, (void*)screen.image.data_, pitch);
         if(error)
         {
             print_error("SDL_UpdateTexture failed");
+            return;
+        }
+
+        screen.upload_bytes += (u64)screen.image.width * screen.image.height * SCREEN_BYTES_PER_PIXEL;
+    }
+
+
+    static u64 hash_tile(image::Image const& image, Rect2Du32 const& range)
+    {
+        auto const row_bytes = (range.x_end - range.x_begin) * SCREEN_BYTES_PER_PIXEL;
+
+        u64 h = 0;
+        for (u32 y = range.y_begin; y < range.y_end; y++)
+        {
+            h = hash::hash_bytes(image.data_ + (u64)y * image.width + range.x_begin, row_bytes, h);
+        }
+
+        return h;
+    }
+
+
+    // calls func(rect) for each run of tiles that changed since the last call
+    template <class FUNC>
+    static void for_each_changed_tiles(ScreenMemory& screen, FUNC const& func)
+    {
+        auto const width = screen.image.width;
+        auto const height = screen.image.height;
+
+        for (u32 ty = 0; ty < screen.tiles_y; ty++)
+        {
+            Rect2Du32 run{};
+            run.y_begin = ty * UPLOAD_TILE_SIZE;
+            run.y_end = std::min(run.y_begin + UPLOAD_TILE_SIZE, height);
+
+            bool in_run = false;
+
+            // changed tiles next to each other in a row are uploaded together
+            for (u32 tx = 0; tx < screen.tiles_x; tx++)
+            {
+                Rect2Du32 tile = run;
+                tile.x_begin = tx * UPLOAD_TILE_SIZE;
+                tile.x_end = std::min(tile.x_begin + UPLOAD_TILE_SIZE, width);
+
+                auto& tile_hash = screen.tile_hashes[ty * screen.tiles_x + tx];
+                auto const h = hash_tile(screen.image, tile);
+                auto const changed = !screen.tiles_valid || h != tile_hash;
+                tile_hash = h;
+
+                if (changed)
+                {
+                    if (!in_run)
+                    {
+                        run.x_begin = tile.x_begin;
+                        in_run = true;
+                    }
+
+                    run.x_end = tile.x_end;
+                }
+                else if (in_run)
+                {
+                    func(run);
+                    in_run = false;
+                }
+            }
+
+            if (in_run)
+            {
+                func(run);
+            }
+        }
+
+        screen.tiles_valid = 1;
+    }
+
+
+    static void update_texture_tiles(ScreenMemory& screen)
+    {
+        for_each_changed_tiles(screen, [&](Rect2Du32 const& range){ update_texture_rect(screen, range); });
+    }
+
+
+    // view of the texture memory for the app to render the next frame into
+    static bool lock_screen(ScreenMemory& screen, image::ImageView& view)
+    {
+        assert(screen.presenter == Presenter::Renderer);
+        assert(screen.upload_mode == UploadMode::Locked);
+        assert(!screen.is_locked);
+
+        void* pixels = nullptr;
+        int pitch = 0;
+
+        auto error = SDL_LockTexture(screen.texture, 0, &pixels, &pitch);
+        if (error)
+        {
+            print_error("SDL_LockTexture failed");
+            return false;
         }
 
-        error = SDL_RenderCopy(screen.renderer, screen.texture, 0, 0);
+        assert(pitch % SCREEN_BYTES_PER_PIXEL == 0);
+
+        screen.is_locked = 1;
+
+        view.matrix_data_ = (image::Pixel*)pixels;
+        view.matrix_width = (u32)pitch / SCREEN_BYTES_PER_PIXEL;
+        view.width = screen.image.width;
+        view.height = screen.image.height;
+
+        return true;
+    }
+
+
+    static void present_renderer(ScreenMemory& screen, image::DirtyRects const& dirty)
+    {
+        switch (screen.upload_mode)
+        {
+        case UploadMode::Full:
+            update_texture_full(screen);
+            break;
+
+        case UploadMode::DirtyRects:
+            for (u32 i = 0; i < dirty.count; i++)
+            {
+                update_texture_rect(screen, dirty.rects[i]);
+            }
+            break;
+
+        case UploadMode::Tiles:
+            update_texture_tiles(screen);
+            break;
+
+        case UploadMode::Locked:
+            if (screen.is_locked)
+            {
+                SDL_UnlockTexture(screen.texture);
+                screen.is_locked = 0;
+            }
+            break;
+        }
+
+        auto error = SDL_RenderCopy(screen.renderer, screen.texture, 0, 0);
         if(error)
         {
             print_error("SDL_RenderCopy failed");
@@ -446,3 +760,220 @@ namespace sdl
         SDL_RenderPresent(screen.renderer);
     }
 }
+
+
+/* window surface */
+
+namespace sdl
+{
+    namespace surface
+    {
+        // rects written to the surface, pushed to the window in batches
+        class SurfaceRects
+        {
+        public:
+            static constexpr u32 capacity = 16;
+
+            SDL_Rect rects[capacity];
+
+            u32 count = 0;
+        };
+
+
+        static void flush_rects(ScreenMemory& screen, SurfaceRects& rects)
+        {
+            if (!rects.count)
+            {
+                return;
+            }
+
+            auto error = SDL_UpdateWindowSurfaceRects(screen.window, rects.rects, (int)rects.count);
+            if (error)
+            {
+                print_error("SDL_UpdateWindowSurfaceRects failed");
+            }
+
+            rects.count = 0;
+        }
+
+
+        static inline u32 to_surface_pixel(image::Pixel p, SDL_PixelFormat const* format)
+        {
+            return
+                ((u32)p.red << format->Rshift) |
+                ((u32)p.green << format->Gshift) |
+                ((u32)p.blue << format->Bshift) |
+                format->Amask;
+        }
+
+
+        // integer scale and centered offset of the image on the surface
+        static bool resize_surface(ScreenMemory& screen, SDL_Surface* surface)
+        {
+            auto const width = (u32)surface->w;
+            auto const height = (u32)surface->h;
+
+            if (surface == screen.surface && width == screen.surface_width && height == screen.surface_height)
+            {
+                return false;
+            }
+
+            screen.surface = surface;
+            screen.surface_width = width;
+            screen.surface_height = height;
+
+            screen.surface_scale = std::min(width / screen.image.width, height / screen.image.height);
+            screen.surface_x = (width - screen.surface_scale * screen.image.width) / 2;
+            screen.surface_y = (height - screen.surface_scale * screen.image.height) / 2;
+
+            SDL_FillRect(surface, 0, SDL_MapRGB(surface->format, 0, 0, 0));
+
+            return true;
+        }
+
+
+        static void write_scaled(ScreenMemory& screen, Rect2Du32 const& range, SurfaceRects& rects)
+        {
+            auto const surface = screen.surface;
+            auto const format = surface->format;
+            auto const scale = screen.surface_scale;
+
+            auto const width = range.x_end - range.x_begin;
+            auto const dst_row_bytes = (u64)width * scale * sizeof(u32);
+
+            for (u32 y = range.y_begin; y < range.y_end; y++)
+            {
+                auto src = screen.image.data_ + (u64)y * screen.image.width + range.x_begin;
+
+                auto dst_y = screen.surface_y + y * scale;
+                auto dst_row = (u8*)surface->pixels + (u64)dst_y * surface->pitch;
+                auto dst = (u32*)dst_row + screen.surface_x + range.x_begin * scale;
+
+                auto d = dst;
+                for (u32 x = 0; x < width; x++)
+                {
+                    auto const p = to_surface_pixel(src[x], format);
+                    for (u32 s = 0; s < scale; s++)
+                    {
+                        *d++ = p;
+                    }
+                }
+
+                // remaining rows of the scaled row are copies
+                for (u32 s = 1; s < scale; s++)
+                {
+                    std::memcpy((u8*)dst + (u64)s * surface->pitch, dst, dst_row_bytes);
+                }
+            }
+
+            if (rects.count == rects.capacity)
+            {
+                flush_rects(screen, rects);
+            }
+
+            auto& rect = rects.rects[rects.count++];
+            rect.x = (int)(screen.surface_x + range.x_begin * scale);
+            rect.y = (int)(screen.surface_y + range.y_begin * scale);
+            rect.w = (int)(width * scale);
+            rect.h = (int)((range.y_end - range.y_begin) * scale);
+
+            screen.upload_bytes += dst_row_bytes * (range.y_end - range.y_begin) * scale;
+        }
+    }
+
+
+    static void present_window_surface(ScreenMemory& screen, image::DirtyRects const& dirty)
+    {
+        auto window_surface = SDL_GetWindowSurface(screen.window);
+        if (!window_surface)
+        {
+            print_error("SDL_GetWindowSurface failed");
+            return;
+        }
+
+        // a new surface has none of the image
+        auto const redraw = surface::resize_surface(screen, window_surface);
+
+        if (!screen.surface_scale)
+        {
+            // window is smaller than the image
+            return;
+        }
+
+        auto const must_lock = SDL_MUSTLOCK(window_surface);
+        if (must_lock && SDL_LockSurface(window_surface))
+        {
+            print_error("SDL_LockSurface failed");
+            return;
+        }
+
+        Rect2Du32 full{};
+        full.x_begin = 0;
+        full.x_end = screen.image.width;
+        full.y_begin = 0;
+        full.y_end = screen.image.height;
+
+        surface::SurfaceRects rects{};
+
+        auto const write = [&](Rect2Du32 const& range){ surface::write_scaled(screen, range, rects); };
+
+        switch (redraw ? UploadMode::Full : screen.upload_mode)
+        {
+        case UploadMode::DirtyRects:
+            for (u32 i = 0; i < dirty.count; i++)
+            {
+                write(dirty.rects[i]);
+            }
+            break;
+
+        case UploadMode::Tiles:
+            for_each_changed_tiles(screen, write);
+            break;
+
+        default:
+            write(full);
+            screen.tiles_valid = 0;
+            break;
+        }
+
+        if (must_lock)
+        {
+            SDL_UnlockSurface(window_surface);
+        }
+
+        surface::flush_rects(screen, rects);
+    }
+
+
+    static void render_screen(ScreenMemory& screen, image::DirtyRects const& dirty)
+    {
+        screen.upload_bytes = 0;
+
+        switch (screen.presenter)
+        {
+        case Presenter::WindowSurface:
+            present_window_surface(screen, dirty);
+            break;
+
+        default:
+            present_renderer(screen, dirty);
+            break;
+        }
+    }
+
+
+    static void render_screen(ScreenMemory& screen)
+    {
+        image::DirtyRects none{};
+
+        auto const mode = screen.upload_mode;
+        if (mode != UploadMode::Locked)
+        {
+            screen.upload_mode = UploadMode::Full;
+        }
+
+        render_screen(screen, none);
+
+        screen.upload_mode = mode;
+    }
+}
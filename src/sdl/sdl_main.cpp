@@ -1,5 +1,10 @@
 #include "sdl_include.hpp"
+#include "../input/input_state.hpp"
+#include "../input/input_record.hpp"
 #include "../util/stopwatch.hpp"
+#include "../util/profiler.hpp"
+#include "../util/frame_pacer.hpp"
+#include "../util/startup_timer.hpp"
 #include "../app/app.hpp"
 
 #ifndef NDEBUG
@@ -8,8 +13,10 @@
 
 #endif
 
-#include <thread>
 #include <cassert>
+#include <cmath>
+#include <cstring>
+#include <thread>
 
 
 constexpr auto WINDOW_TITLE = config::APP_TITLE;
@@ -19,9 +26,44 @@ constexpr f64 NANO = 1'000'000'000;
 constexpr f64 TARGET_FRAMERATE_HZ = 60.0f;
 constexpr f64 TARGET_NS_PER_FRAME = NANO / TARGET_FRAMERATE_HZ;
 
+#ifdef PROFILER_ON
+constexpr auto PROFILE_TRACE_PATH = "sdl_app_trace.json";
+#endif
+
+// simulate in fixed steps of wall time, render once per displayed frame
+constexpr bool FIXED_TIMESTEP = true;
+
+constexpr f64 SIM_STEP_HZ = 60.0;
+constexpr f64 SIM_STEP_NS = NANO / SIM_STEP_HZ;
+
+// more steps than this in one frame and the simulation drops time instead of catching up
+constexpr u32 MAX_SIM_STEPS = 5;
+
+// frame times this close to one step count as exactly one step
+constexpr f64 SIM_SNAP_NS = 250'000;
+
+// how the screen gets to the window
+constexpr auto PRESENTER = sdl::Presenter::Auto;
+
+// how much of the screen is sent to the texture each frame
+constexpr auto UPLOAD_MODE = sdl::UploadMode::DirtyRects;
+
+// render the next frame on another thread while this one is presented
+// the window shows each frame one frame later
+constexpr bool PIPELINED = false;
+
+// one buffer being presented, one being rendered
+constexpr u32 N_SCREEN_BUFFERS = 2;
+
+// the render thread cannot write to a texture locked by this one
+static_assert(!PIPELINED || UPLOAD_MODE != sdl::UploadMode::Locked);
+
 
 static bool g_running = false;
 
+// every simulated step is written here when recording
+static input::InputRecorder g_recorder;
+
 
 static void end_program()
 {
@@ -29,6 +71,333 @@ static void end_program()
 }
 
 
+class AppArgs
+{
+public:
+    // --record <path>
+    cstr record_path = nullptr;
+
+    // --exit-after-first-frame
+    b32 exit_after_first_frame = 0;
+
+    // --startup-json <path>
+    cstr startup_json_path = nullptr;
+};
+
+
+static bool parse_args(int argc, char* argv[], AppArgs& args)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+        {
+            args.record_path = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--exit-after-first-frame") == 0)
+        {
+            args.exit_after_first_frame = 1;
+        }
+        else if (std::strcmp(argv[i], "--startup-json") == 0 && i + 1 < argc)
+        {
+            args.startup_json_path = argv[++i];
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+static void simulate_step(app::AppState& app_state, input::Input const& input)
+{
+    if (g_recorder.file && !input::record_frame(g_recorder, input))
+    {
+        print_message("Error: input::record_frame()");
+        input::end_recording(g_recorder);
+    }
+
+    app::simulate(app_state, input);
+}
+
+
+class SimClock
+{
+public:
+    f64 accumulator_ns = 0.0;
+
+    input::Input step_input;
+
+    // input from frames that ran no step
+    input::Input pending_input;
+    b32 has_pending_input = 0;
+};
+
+
+// runs the steps that fit in the time since the last frame
+// returns how far into the next step the frame is, 0 to 1
+static f32 simulate_steps(app::AppState& app_state, SimClock& sim, input::Input& frame_input, f64 frame_ns)
+{
+    // pacing jitter around one step would alternate between 0 and 2 steps
+    if (std::abs(frame_ns - SIM_STEP_NS) < SIM_SNAP_NS)
+    {
+        frame_ns = SIM_STEP_NS;
+    }
+
+    if (sim.has_pending_input)
+    {
+        input::merge_input_edges(sim.pending_input, frame_input);
+    }
+
+    frame_input.dt_frame = (f32)(SIM_STEP_NS / NANO);
+
+    sim.accumulator_ns += frame_ns;
+
+    u32 n_steps = 0;
+    while (sim.accumulator_ns >= SIM_STEP_NS && n_steps < MAX_SIM_STEPS)
+    {
+        if (n_steps == 0)
+        {
+            simulate_step(app_state, frame_input);
+        }
+        else
+        {
+            // presses and releases belong to the first step only
+            if (n_steps == 1)
+            {
+                sim.step_input = frame_input;
+                input::clear_input_edges(sim.step_input);
+            }
+
+            simulate_step(app_state, sim.step_input);
+        }
+
+        sim.accumulator_ns -= SIM_STEP_NS;
+        ++n_steps;
+    }
+
+    if (sim.accumulator_ns >= SIM_STEP_NS)
+    {
+        sim.accumulator_ns = std::fmod(sim.accumulator_ns, SIM_STEP_NS);
+    }
+
+    sim.has_pending_input = n_steps == 0;
+    if (sim.has_pending_input)
+    {
+        sim.pending_input = frame_input;
+    }
+
+    return (f32)(sim.accumulator_ns / SIM_STEP_NS);
+}
+
+
+/* render pipeline */
+
+// The handoff uses two semaphores rather than an atomic slot index.
+// Exactly one frame is in flight and the simulation reads the app state the render thread draws from,
+// so the main thread has to wait for the render in flight before it simulates the next step.
+// A blocking wait keeps the waiting thread off the core, an atomic index would have to spin or yield.
+// Only the present of the previous frame overlaps the render.
+class RenderPipeline
+{
+public:
+    // buffer 0 is the screen image, the others are owned here
+    image::Image buffers[N_SCREEN_BUFFERS];
+
+    // regions redrawn by the frame each buffer holds
+    image::DirtyRects dirty[N_SCREEN_BUFFERS];
+
+    // regions redrawn into the other buffers since each one was rendered
+    image::DirtyRects stale[N_SCREEN_BUFFERS];
+
+    u32 front = 0;
+    u32 back = 0;
+
+    // a finished frame is waiting in front
+    b32 has_front = 0;
+
+    // the render thread owns back until it posts render_done
+    b32 is_rendering = 0;
+
+    f32 alpha = 1.0f;
+    b32 is_running = 0;
+
+    SDL_sem* render_start = nullptr;
+    SDL_sem* render_done = nullptr;
+
+    std::thread thread;
+};
+
+
+static void render_thread_proc(RenderPipeline& pipeline, app::AppState& app_state)
+{
+    PROFILE_THREAD();
+
+    while (true)
+    {
+        SDL_SemWait(pipeline.render_start);
+
+        if (!pipeline.is_running)
+        {
+            break;
+        }
+
+        {
+            PROFILE_ZONE("app::render");
+            app::render(app_state, pipeline.alpha);
+        }
+
+        SDL_SemPost(pipeline.render_done);
+    }
+}
+
+
+static bool create_pipeline(RenderPipeline& pipeline, sdl::ScreenMemory const& screen, app::AppState& app_state)
+{
+    auto const& screen_image = screen.image;
+
+    Rect2Du32 full{};
+    full.x_begin = 0;
+    full.x_end = screen_image.width;
+    full.y_begin = 0;
+    full.y_end = screen_image.height;
+
+    pipeline.buffers[0] = screen_image;
+
+    for (u32 i = 1; i < N_SCREEN_BUFFERS; i++)
+    {
+        if (!image::create_image(pipeline.buffers[i], screen_image.width, screen_image.height))
+        {
+            return false;
+        }
+
+        // never rendered
+        image::mark_dirty(pipeline.stale[i], full);
+    }
+
+    pipeline.render_start = SDL_CreateSemaphore(0);
+    pipeline.render_done = SDL_CreateSemaphore(0);
+    if (!pipeline.render_start || !pipeline.render_done)
+    {
+        sdl::print_error("SDL_CreateSemaphore()");
+        return false;
+    }
+
+    pipeline.is_running = 1;
+    pipeline.thread = std::thread(render_thread_proc, std::ref(pipeline), std::ref(app_state));
+
+    return true;
+}
+
+
+// waits for the frame in flight, it becomes the front buffer
+static void finish_render(RenderPipeline& pipeline, app::AppState const& app_state)
+{
+    if (!pipeline.is_rendering)
+    {
+        return;
+    }
+
+    SDL_SemWait(pipeline.render_done);
+    pipeline.is_rendering = 0;
+
+    auto const b = pipeline.back;
+    auto const& dirty = app_state.screen_dirty;
+
+    pipeline.dirty[b] = dirty;
+
+    for (u32 i = 0; i < N_SCREEN_BUFFERS; i++)
+    {
+        if (i == b)
+        {
+            continue;
+        }
+
+        for (u32 r = 0; r < dirty.count; r++)
+        {
+            image::mark_dirty(pipeline.stale[i], dirty.rects[r]);
+        }
+    }
+
+    pipeline.front = b;
+    pipeline.has_front = 1;
+}
+
+
+// renders the latest step into a buffer the presenter is not reading
+static void start_render(RenderPipeline& pipeline, app::AppState& app_state, f32 alpha)
+{
+    assert(!pipeline.is_rendering);
+
+    auto const b = (pipeline.front + 1) % N_SCREEN_BUFFERS;
+
+    app_state.screen.matrix_data_ = pipeline.buffers[b].data_;
+    app_state.screen_stale = pipeline.stale[b];
+    image::clear_dirty(pipeline.stale[b]);
+
+    pipeline.back = b;
+    pipeline.alpha = alpha;
+    pipeline.is_rendering = 1;
+
+    SDL_SemPost(pipeline.render_start);
+}
+
+
+// false when no frame has been rendered yet
+static bool present_front(RenderPipeline& pipeline, sdl::ScreenMemory& screen)
+{
+    if (!pipeline.has_front)
+    {
+        return false;
+    }
+
+    screen.image.data_ = pipeline.buffers[pipeline.front].data_;
+    sdl::render_screen(screen, pipeline.dirty[pipeline.front]);
+
+    pipeline.has_front = 0;
+
+    return true;
+}
+
+
+static void destroy_pipeline(RenderPipeline& pipeline, sdl::ScreenMemory& screen, app::AppState const& app_state)
+{
+    if (pipeline.thread.joinable())
+    {
+        finish_render(pipeline, app_state);
+
+        pipeline.is_running = 0;
+        SDL_SemPost(pipeline.render_start);
+        pipeline.thread.join();
+    }
+
+    if (pipeline.render_start)
+    {
+        SDL_DestroySemaphore(pipeline.render_start);
+        pipeline.render_start = nullptr;
+    }
+
+    if (pipeline.render_done)
+    {
+        SDL_DestroySemaphore(pipeline.render_done);
+        pipeline.render_done = nullptr;
+    }
+
+    // the screen frees its own image
+    screen.image.data_ = pipeline.buffers[0].data_;
+
+    for (u32 i = 1; i < N_SCREEN_BUFFERS; i++)
+    {
+        if (pipeline.buffers[i].data_)
+        {
+            image::destroy_image(pipeline.buffers[i]);
+        }
+    }
+}
+
+
 static void handle_sdl_event(SDL_Event const& event, SDL_Window* window)
 {
     switch(event.type)
@@ -87,15 +456,52 @@ static void handle_sdl_event(SDL_Event const& event, SDL_Window* window)
 }
 
 
+// every startup phase, printed in release builds too
+static void report_startup(AppArgs const& args)
+{
+    startup_timer::print_table();
+
+    if (args.startup_json_path && !startup_timer::write_json(args.startup_json_path))
+    {
+        print_message("Error: startup_timer::write_json()");
+    }
+}
+
+
 int main(int argc, char *argv[])
 {
-    if(!sdl::init())
+    // startup phases are timed from here
+    startup_timer::now_ns();
+
+    PROFILE_THREAD();
+
+    AppArgs args{};
+    if (!parse_args(argc, argv, args))
+    {
+        print_message("usage: sdl_app [--record <path>] [--exit-after-first-frame] [--startup-json <path>]");
+        return EXIT_FAILURE;
+    }
+
+    auto const sdl_ok = [&]()
+    {
+        STARTUP_PHASE("SDL_Init");
+        return sdl::init();
+    }();
+
+    if (!sdl_ok)
     {        
         return EXIT_FAILURE;
     }
 
     app::AppState app_state{};
-    if (!app::init(app_state))
+
+    auto const app_ok = [&]()
+    {
+        STARTUP_PHASE("app::init");
+        return app::init(app_state);
+    }();
+
+    if (!app_ok)
     {
         print_message("Error: app::init()");
         sdl::close();
@@ -124,7 +530,16 @@ int main(int argc, char *argv[])
     window_dim.y = config::WINDOW_SCALE * screen_height;
 
     sdl::ScreenMemory screen{};
-    if(!sdl::create_screen_memory(screen, WINDOW_TITLE, screen_dim, window_dim))
+    screen.presenter = PRESENTER;
+    screen.upload_mode = UPLOAD_MODE;
+
+    auto const screen_ok = [&]()
+    {
+        STARTUP_PHASE("window/renderer/texture");
+        return sdl::create_screen_memory(screen, WINDOW_TITLE, screen_dim, window_dim);
+    }();
+
+    if (!screen_ok)
     {
         print_message("Error: sdl::create_screen_memory()");
         sdl::close();
@@ -133,37 +548,84 @@ int main(int argc, char *argv[])
 
     app_state.screen.matrix_data_ = screen.image.data_;
 
+    // the presenter can change the upload mode
+    auto const render_locked = screen.upload_mode == sdl::UploadMode::Locked;
+
+    Rect2Du32 screen_rect{};
+    screen_rect.x_begin = 0;
+    screen_rect.x_end = screen_width;
+    screen_rect.y_begin = 0;
+    screen_rect.y_end = screen_height;
+
+    static RenderPipeline pipeline{};
+
+    if (PIPELINED && !create_pipeline(pipeline, screen, app_state))
+    {
+        print_message("Error: create_pipeline()");
+        destroy_pipeline(pipeline, screen, app_state);
+        app::close(app_state);
+        sdl::close();
+        return EXIT_FAILURE;
+    }
+
     input::Input input[2] = {};
     sdl::ControllerInput controller_input = {};
-    sdl::open_game_controllers(controller_input, input[0]);
+    {
+        STARTUP_PHASE("open_game_controllers");
+        sdl::open_game_controllers(controller_input, input[0]);
+    }
     input[1].num_controllers = input[0].num_controllers;
 
     auto const cleanup = [&]()
     {
+        if (PIPELINED)
+        {
+            destroy_pipeline(pipeline, screen, app_state);
+        }
+
+        input::end_recording(g_recorder);
         app::close(app_state);
         sdl::close_game_controllers(controller_input, input[0]);
         sdl::close();
     };
 
+    if (args.record_path && !input::begin_recording(g_recorder, args.record_path))
+    {
+        print_message("Error: input::begin_recording()");
+        cleanup();
+        return EXIT_FAILURE;
+    }
+
     b32 frame_curr = 0;
     b32 frame_prev = 1;
 
     Stopwatch sw;
-    f64 frame_nano = TARGET_NS_PER_FRAME;    
+    f64 frame_nano = TARGET_NS_PER_FRAME;
+
+    frame_pacer::FramePacer pacer{};
+
+    static SimClock sim{};
 
 #ifndef NDEBUG
     f64 dbg_ns_elapsed = 0.0;
     constexpr f64 dbg_title_refresh_ns = NANO * 0.25;
-    constexpr int dbg_TITLE_LEN = 50;
+    constexpr int dbg_TITLE_LEN = 100;
     char dbg_title[dbg_TITLE_LEN] = { 0 };
     int dbg_frame_milli = 0;
+    u32 dbg_scratch_bytes = 0;
 #endif
 
+    auto is_first_frame = true;
+
     g_running = true;
 
     sw.start();
+    frame_pacer::start(pacer, TARGET_FRAMERATE_HZ);
+
     while(g_running)
     {
+        PROFILE_ZONE("frame");
+
         sdl::EventInfo evt{};
         evt.first_in_queue = true;
         evt.has_event = false;
@@ -171,43 +633,88 @@ int main(int argc, char *argv[])
         auto& input_curr = input[frame_curr];
         auto& input_prev = input[frame_prev];
 
-        while (SDL_PollEvent(&evt.event))
         {
-            evt.has_event = true;
-            handle_sdl_event(evt.event, screen.window);
-            input::process_keyboard_input(evt, input_prev.keyboard, input_curr.keyboard);
-            input::process_mouse_input(evt, input_prev.mouse, input_curr.mouse);
-            evt.first_in_queue = false;
+            PROFILE_ZONE("poll_events");
+
+            while (SDL_PollEvent(&evt.event))
+            {
+                evt.has_event = true;
+                handle_sdl_event(evt.event, screen.window);
+                input::process_keyboard_input(evt, input_prev.keyboard, input_curr.keyboard);
+                input::process_mouse_input(evt, input_prev.mouse, input_curr.mouse);
+                evt.first_in_queue = false;
+            }
+
+            if (!evt.has_event)
+            {
+                input::process_keyboard_input(evt, input_prev.keyboard, input_curr.keyboard);
+                input::process_mouse_input(evt, input_prev.mouse, input_curr.mouse);
+            }
         }
 
-        if (!evt.has_event)
         {
-            input::process_keyboard_input(evt, input_prev.keyboard, input_curr.keyboard);
-            input::process_mouse_input(evt, input_prev.mouse, input_curr.mouse);
+            PROFILE_ZONE("process_controller_input");
+            input::process_controller_input(controller_input, input_prev, input_curr);
         }
 
-        input::process_controller_input(controller_input, input_prev, input_curr);
+        if (PIPELINED)
+        {
+            // the render thread reads the step simulated before it
+            PROFILE_ZONE("finish_render");
+            finish_render(pipeline, app_state);
+        }
 
-        // does not miss frames but slows animation
-        input_curr.dt_frame = (f32)(1.0 / TARGET_FRAMERATE_HZ);
+        f32 alpha = 1.0f;
 
-        app::update(app_state, input_curr);
+        if (FIXED_TIMESTEP)
+        {
+            PROFILE_ZONE("app::simulate");
+            alpha = simulate_steps(app_state, sim, input_curr, frame_nano);
+        }
+        else
+        {
+            PROFILE_ZONE("app::simulate");
 
-        // track frame rate
-        frame_nano = sw.get_time_nano();
+            // does not miss frames but slows animation
+            input_curr.dt_frame = (f32)(1.0 / TARGET_FRAMERATE_HZ);
+            simulate_step(app_state, input_curr);
+        }
 
 #ifndef NDEBUG
-        dbg_frame_milli = (int)(frame_nano / 1'000'000 + 0.5);
+        // the render thread writes it once started
+        dbg_scratch_bytes = app_state.scratch_high_water;
 #endif
 
-        auto sleep_ns = TARGET_NS_PER_FRAME - frame_nano;
-        if (sleep_ns > 0)
-        { 
-            std::this_thread::sleep_for(std::chrono::nanoseconds((i64)(sleep_ns)));
-            while (frame_nano < TARGET_NS_PER_FRAME)
+        if (PIPELINED)
+        {
+            start_render(pipeline, app_state, alpha);
+        }
+        else
+        {
+            if (render_locked)
             {
-                frame_nano = sw.get_time_nano();
-            }        
+                if (!sdl::lock_screen(screen, app_state.screen))
+                {
+                    end_program();
+                    break;
+                }
+
+                // the locked texture is write only, the app redraws all of it
+                image::mark_dirty(app_state.screen_stale, screen_rect);
+            }
+
+            PROFILE_ZONE("app::render");
+            app::render(app_state, alpha);
+        }
+
+#ifndef NDEBUG
+        dbg_frame_milli = (int)(sw.get_time_nano() / 1'000'000 + 0.5);
+#endif
+
+        // track frame rate
+        {
+            PROFILE_ZONE("wait_next_frame");
+            frame_nano = (f64)frame_pacer::wait_next_frame(pacer);
         }
 
         sw.start();
@@ -217,20 +724,77 @@ int main(int argc, char *argv[])
         if(dbg_ns_elapsed >= dbg_title_refresh_ns)
         {
             auto fps = (int)(NANO / frame_nano + 0.5);
-            qsnprintf(dbg_title, dbg_TITLE_LEN, "%s (%d fps / %d ms)", WINDOW_TITLE, fps, dbg_frame_milli);
+            auto upload_kb = (int)((screen.upload_bytes + 512) / 1024);
+
+            // since the last title
+            auto& stats = pacer.stats;
+            auto missed = (int)stats.n_missed;
+            auto spin_pct = 100.0 * stats.spin_ns / dbg_ns_elapsed;
+            frame_pacer::reset_stats(pacer);
+
+            qsnprintf(dbg_title, dbg_TITLE_LEN, "%s (%d fps / %d ms / %d KB / %d missed / %.1f%% spin / %u B scratch)", 
+                WINDOW_TITLE, fps, dbg_frame_milli, upload_kb, missed, spin_pct, dbg_scratch_bytes);
             SDL_SetWindowTitle(screen.window, dbg_title);
 
             dbg_ns_elapsed = 0.0;
         }
 #endif
 
-        sdl::render_screen(screen);
+        auto is_presented = true;
+
+        if (PIPELINED)
+        {
+            PROFILE_ZONE("render_screen");
+            is_presented = present_front(pipeline, screen);
+        }
+        else
+        {
+            PROFILE_ZONE("render_screen");
+            sdl::render_screen(screen, app_state.screen_dirty);
+        }
+
+        // launch to the first frame in the window, audio may still be loading
+        if (is_first_frame && is_presented)
+        {
+            startup_timer::record_phase("first frame", 0, startup_timer::now_ns());
+            is_first_frame = false;
+
+            if (args.exit_after_first_frame)
+            {
+                end_program();
+            }
+        }
 
         frame_prev = frame_curr;
         frame_curr = !frame_curr;
     }
 
+    // the render thread stops recording before the trace is written, cleanup skips it after
+    if (PIPELINED)
+    {
+        destroy_pipeline(pipeline, screen, app_state);
+    }
+
+#ifdef PROFILER_ON
+    if (!profiler::write_chrome_trace(PROFILE_TRACE_PATH))
+    {
+        print_message("Error: profiler::write_chrome_trace()");
+    }
+#endif
+
+    // measuring the first frame does not wait on the audio loader, cleanup cancels it
+    if (args.exit_after_first_frame)
+    {
+        report_startup(args);
+    }
+
+    // joins the audio loader, its phases are recorded by then
     cleanup();
 
+    if (!args.exit_after_first_frame)
+    {
+        report_startup(args);
+    }
+
     return EXIT_SUCCESS;
 }
\ No newline at end of file
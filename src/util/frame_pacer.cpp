@@ -0,0 +1,168 @@
+#include "frame_pacer.hpp"
+
+#if defined(__linux__)
+
+#include <time.h>
+#include <cerrno>
+
+#else
+
+#include <chrono>
+#include <thread>
+
+#endif
+
+
+namespace frame_pacer
+{
+    // bounds on the learned oversleep
+    constexpr u64 MIN_SLACK_NS = 50'000;
+    constexpr u64 MAX_SLACK_NS = 4'000'000;
+
+    // an oversleep raises the slack at once, it falls back by 1/16 of the difference per frame
+    constexpr u64 SLACK_DECAY_SHIFT = 4;
+
+    // later than this after the deadline counts as a missed frame
+    constexpr u64 MISS_TOLERANCE_NS = 500'000;
+
+
+#if defined(__linux__)
+
+    u64 now_ns()
+    {
+        timespec ts{};
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return (u64)ts.tv_sec * 1'000'000'000 + (u64)ts.tv_nsec;
+    }
+
+
+    static void sleep_until_ns(u64 time_ns)
+    {
+        timespec ts{};
+        ts.tv_sec = (time_t)(time_ns / 1'000'000'000);
+        ts.tv_nsec = (long)(time_ns % 1'000'000'000);
+
+        int rc = 0;
+        do
+        {
+            rc = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
+        }
+        while (rc == EINTR);
+    }
+
+#else
+
+    using clock = std::chrono::steady_clock;
+
+
+    u64 now_ns()
+    {
+        return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now().time_since_epoch()).count();
+    }
+
+
+    static void sleep_until_ns(u64 time_ns)
+    {
+        std::this_thread::sleep_until(clock::time_point(std::chrono::duration_cast<clock::duration>(std::chrono::nanoseconds(time_ns))));
+    }
+
+#endif
+
+
+    static void learn_oversleep(FramePacer& pacer, u64 oversleep_ns)
+    {
+        auto slack = pacer.slack_ns;
+
+        if (oversleep_ns > slack)
+        {
+            slack = oversleep_ns;
+        }
+        else
+        {
+            slack -= (slack - oversleep_ns) >> SLACK_DECAY_SHIFT;
+        }
+
+        slack = slack < MIN_SLACK_NS ? MIN_SLACK_NS : slack;
+        slack = slack > MAX_SLACK_NS ? MAX_SLACK_NS : slack;
+
+        pacer.slack_ns = slack;
+    }
+
+
+    void start(FramePacer& pacer, f64 target_hz)
+    {
+        pacer.frame_ns = (u64)(1'000'000'000 / target_hz);
+        pacer.slack_ns = MIN_SLACK_NS * 2;
+        pacer.frame_begin_ns = now_ns();
+        pacer.deadline_ns = pacer.frame_begin_ns + pacer.frame_ns;
+
+        reset_stats(pacer);
+    }
+
+
+    u64 wait_next_frame(FramePacer& pacer)
+    {
+        auto& stats = pacer.stats;
+
+        auto now = now_ns();
+
+        if (now + pacer.slack_ns < pacer.deadline_ns)
+        {
+            auto const wake_ns = pacer.deadline_ns - pacer.slack_ns;
+
+            sleep_until_ns(wake_ns);
+
+            auto const woke = now_ns();
+            stats.sleep_ns += woke - now;
+
+            learn_oversleep(pacer, woke > wake_ns ? woke - wake_ns : 0);
+
+            now = woke;
+        }
+
+        if (now < pacer.deadline_ns)
+        {
+            auto const spin_begin = now;
+            while (now < pacer.deadline_ns)
+            {
+                now = now_ns();
+            }
+
+            stats.spin_ns += now - spin_begin;
+        }
+
+        auto const late_ns = now - pacer.deadline_ns;
+        auto const missed = late_ns > MISS_TOLERANCE_NS;
+
+        if (missed)
+        {
+            stats.n_missed++;
+            stats.max_late_ns = late_ns > stats.max_late_ns ? late_ns : stats.max_late_ns;
+        }
+
+        stats.n_frames++;
+
+        auto const elapsed_ns = now - pacer.frame_begin_ns;
+
+        pacer.frame_begin_ns = now;
+
+        // a late frame starts a new schedule rather than shortening the next one
+        if (missed)
+        {
+            pacer.deadline_ns = now + pacer.frame_ns;
+        }
+        else
+        {
+            pacer.deadline_ns += pacer.frame_ns;
+        }
+
+        return elapsed_ns;
+    }
+
+
+    void reset_stats(FramePacer& pacer)
+    {
+        pacer.stats = PacerStats{};
+    }
+}
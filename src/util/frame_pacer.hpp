@@ -0,0 +1,47 @@
+#pragma once
+
+#include "types.hpp"
+
+
+namespace frame_pacer
+{
+    class PacerStats
+    {
+    public:
+        u64 n_frames = 0;
+
+        // frames that woke after their deadline
+        u64 n_missed = 0;
+        u64 max_late_ns = 0;
+
+        u64 sleep_ns = 0;
+        u64 spin_ns = 0;
+    };
+
+
+    class FramePacer
+    {
+    public:
+        u64 frame_ns = 0;
+
+        // absolute time on the monotonic clock
+        u64 deadline_ns = 0;
+        u64 frame_begin_ns = 0;
+
+        // learned oversleep, the sleep ends this long before the deadline
+        u64 slack_ns = 0;
+
+        PacerStats stats;
+    };
+
+
+    u64 now_ns();
+
+    void start(FramePacer& pacer, f64 target_hz);
+
+    // sleeps and spins until the next deadline
+    // returns the time since the previous frame began
+    u64 wait_next_frame(FramePacer& pacer);
+
+    void reset_stats(FramePacer& pacer);
+}
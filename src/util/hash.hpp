@@ -0,0 +1,127 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <cstring>
+
+
+/* xxh64 */
+
+namespace hash
+{
+    namespace xxh
+    {
+        constexpr u64 P1 = 0x9E3779B185EBCA87ULL;
+        constexpr u64 P2 = 0xC2B2AE3D27D4EB4FULL;
+        constexpr u64 P3 = 0x165667B19E3779F9ULL;
+        constexpr u64 P4 = 0x85EBCA77C2B2AE63ULL;
+        constexpr u64 P5 = 0x27D4EB2F165667C5ULL;
+
+
+        inline u64 rotl(u64 x, int r)
+        {
+            return (x << r) | (x >> (64 - r));
+        }
+
+
+        inline u64 read_u64(u8 const* p)
+        {
+            u64 value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+
+        inline u32 read_u32(u8 const* p)
+        {
+            u32 value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+
+        inline u64 round(u64 acc, u64 input)
+        {
+            acc += input * P2;
+            acc = rotl(acc, 31);
+            return acc * P1;
+        }
+
+
+        inline u64 merge_round(u64 acc, u64 value)
+        {
+            acc ^= round(0, value);
+            return acc * P1 + P4;
+        }
+    }
+
+
+    // XXH64, little endian reads
+    inline u64 hash_bytes(void const* data, u64 n_bytes, u64 seed = 0)
+    {
+        using namespace xxh;
+
+        auto p = (u8 const*)data;
+        auto const end = p + n_bytes;
+
+        u64 h = 0;
+
+        if (n_bytes >= 32)
+        {
+            auto v1 = seed + P1 + P2;
+            auto v2 = seed + P2;
+            auto v3 = seed;
+            auto v4 = seed - P1;
+
+            auto const limit = end - 32;
+            do
+            {
+                v1 = round(v1, read_u64(p));
+                v2 = round(v2, read_u64(p + 8));
+                v3 = round(v3, read_u64(p + 16));
+                v4 = round(v4, read_u64(p + 24));
+                p += 32;
+            }
+            while (p <= limit);
+
+            h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            h = merge_round(h, v1);
+            h = merge_round(h, v2);
+            h = merge_round(h, v3);
+            h = merge_round(h, v4);
+        }
+        else
+        {
+            h = seed + P5;
+        }
+
+        h += n_bytes;
+
+        for (; p + 8 <= end; p += 8)
+        {
+            h ^= round(0, read_u64(p));
+            h = rotl(h, 27) * P1 + P4;
+        }
+
+        if (p + 4 <= end)
+        {
+            h ^= (u64)read_u32(p) * P1;
+            h = rotl(h, 23) * P2 + P3;
+            p += 4;
+        }
+
+        for (; p < end; p++)
+        {
+            h ^= (*p) * P5;
+            h = rotl(h, 11) * P1;
+        }
+
+        h ^= h >> 33;
+        h *= P2;
+        h ^= h >> 29;
+        h *= P3;
+        h ^= h >> 32;
+
+        return h;
+    }
+}
@@ -0,0 +1,61 @@
+#include "memory_buffer.hpp"
+
+#if defined(_WIN32)
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+#else
+
+#include <sys/mman.h>
+
+#endif
+
+
+namespace memory_buffer
+{
+#if defined(_WIN32)
+
+    void* reserve_virtual(u64 n_bytes)
+    {
+        return VirtualAlloc(nullptr, (SIZE_T)n_bytes, MEM_RESERVE, PAGE_NOACCESS);
+    }
+
+
+    bool commit_virtual(void* begin, u64 n_bytes)
+    {
+        return VirtualAlloc(begin, (SIZE_T)n_bytes, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+    }
+
+
+    void release_virtual(void* data, u64 n_bytes)
+    {
+        (void)n_bytes;
+
+        VirtualFree(data, 0, MEM_RELEASE);
+    }
+
+#else
+
+    void* reserve_virtual(u64 n_bytes)
+    {
+        auto data = mmap(nullptr, (size_t)n_bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+        return data == MAP_FAILED ? nullptr : data;
+    }
+
+
+    bool commit_virtual(void* begin, u64 n_bytes)
+    {
+        return mprotect(begin, (size_t)n_bytes, PROT_READ | PROT_WRITE) == 0;
+    }
+
+
+    void release_virtual(void* data, u64 n_bytes)
+    {
+        munmap(data, (size_t)n_bytes);
+    }
+
+#endif
+}
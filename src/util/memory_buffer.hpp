@@ -3,6 +3,7 @@
 #include "types.hpp"
 
 #include <cassert>
+#include <cstdint>
 #include <cstdlib>
 
 
@@ -13,9 +14,31 @@ public:
 	T* data_ = nullptr;
 	u32 capacity_ = 0;
 	u32 size_ = 0;
+
+	// elements of address space behind data_, capacity_ grows into it
+	// 0 when the buffer is a fixed malloc
+	u32 reserve_ = 0;
 };
 
 
+/* virtual memory */
+
+namespace memory_buffer
+{
+	// committed memory grows by at least this much
+	constexpr u64 COMMIT_GRANULARITY = 64 * 1024;
+
+
+	// address space without memory behind it
+	void* reserve_virtual(u64 n_bytes);
+
+	// makes reserved pages readable and writable
+	bool commit_virtual(void* begin, u64 n_bytes);
+
+	void release_virtual(void* data, u64 n_bytes);
+}
+
+
 namespace memory_buffer
 {
 	template <typename T>
@@ -44,10 +67,81 @@ namespace memory_buffer
 	}
 
 
+	// reserves max_elements and commits pages as elements are pushed
+	// data_ never moves, views into the buffer stay valid as it grows
+	template <typename T>
+	bool reserve_buffer(MemoryBuffer<T>& buffer, u32 max_elements)
+	{
+		assert(max_elements);
+		assert(!buffer.data_);
+
+		if (max_elements == 0 || buffer.data_)
+		{
+			return false;
+		}
+
+		auto data = reserve_virtual((u64)max_elements * sizeof(T));
+		assert(data);
+
+		if (!data)
+		{
+			return false;
+		}
+
+		buffer.data_ = (T*)data;
+		buffer.capacity_ = 0;
+		buffer.size_ = 0;
+		buffer.reserve_ = max_elements;
+
+		return true;
+	}
+
+
+	// commits enough of the reserve for n_elements
+	template <typename T>
+	bool grow_buffer(MemoryBuffer<T>& buffer, u64 n_elements)
+	{
+		if (n_elements <= buffer.capacity_)
+		{
+			return true;
+		}
+
+		if (n_elements > buffer.reserve_)
+		{
+			return false;
+		}
+
+		auto const step = COMMIT_GRANULARITY;
+
+		auto const committed = (u64)buffer.capacity_ * sizeof(T);
+		auto const reserved = (u64)buffer.reserve_ * sizeof(T);
+
+		// capacity_ is whole elements, the committed bytes can end inside one
+		auto const commit_begin = committed / step * step;
+
+		auto commit_end = (n_elements * sizeof(T) + step - 1) / step * step;
+		commit_end = commit_end < reserved ? commit_end : reserved;
+
+		auto begin = (u8*)buffer.data_ + commit_begin;
+		if (!commit_virtual(begin, commit_end - commit_begin))
+		{
+			return false;
+		}
+
+		buffer.capacity_ = (u32)(commit_end / sizeof(T));
+
+		return true;
+	}
+
+
 	template <typename T>
 	void destroy_buffer(MemoryBuffer<T>& buffer)
 	{
-		if (buffer.data_)
+		if (buffer.data_ && buffer.reserve_)
+		{
+			release_virtual(buffer.data_, (u64)buffer.reserve_ * sizeof(T));
+		}
+		else if (buffer.data_)
 		{
 			std::free(buffer.data_);
 		}		
@@ -55,6 +149,7 @@ namespace memory_buffer
 		buffer.data_ = nullptr;
 		buffer.capacity_ = 0;
 		buffer.size_ = 0;
+		buffer.reserve_ = 0;
 	}
 	
 
@@ -76,6 +171,13 @@ namespace memory_buffer
 		}
 
 		assert(buffer.data_);
+
+		if (buffer.reserve_ && !grow_buffer(buffer, (u64)buffer.size_ + n_elements))
+		{
+			assert(false && "reserve exhausted");
+			return nullptr;
+		}
+
 		assert(buffer.capacity_);
 
 		auto is_valid =
@@ -120,4 +222,108 @@ namespace memory_buffer
 			buffer.size_ -= n_elements;
 		}
 	}
-}
\ No newline at end of file
+}
+
+
+/* arena */
+
+// bytes for values of any type, each push has its own alignment
+using Arena = MemoryBuffer<u8>;
+
+
+namespace memory_buffer
+{
+	// a cache line, and the widest simd register
+	constexpr u32 SIMD_ALIGNMENT = 64;
+
+
+	// arena bytes that always fit n_bytes at alignment
+	constexpr u32 aligned_size(u32 n_bytes, u32 alignment)
+	{
+		return n_bytes + alignment - 1;
+	}
+
+
+	// alignment is from the address, not the start of the arena
+	template <typename T>
+	T* push(Arena& arena, u32 count, u32 alignment = alignof(T))
+	{
+		assert(count);
+		assert(alignment && !(alignment & (alignment - 1)));
+		assert(alignment >= alignof(T));
+
+		if (count == 0 || !arena.data_)
+		{
+			return nullptr;
+		}
+
+		auto const address = (uintptr_t)(arena.data_ + arena.size_);
+		auto const padding = (u64)((alignment - (address & (alignment - 1))) & (alignment - 1));
+		auto const n_bytes = (u64)count * sizeof(T);
+
+		if (arena.reserve_)
+		{
+			grow_buffer(arena, arena.size_ + padding + n_bytes);
+		}
+
+		auto bytes_available = (u64)(arena.capacity_ - arena.size_) >= padding + n_bytes;
+		assert(bytes_available);
+
+		if (!bytes_available)
+		{
+			return nullptr;
+		}
+
+		auto data = (T*)(arena.data_ + arena.size_ + padding);
+
+		arena.size_ += (u32)(padding + n_bytes);
+
+		return data;
+	}
+
+
+	class ArenaMarker
+	{
+	public:
+		u32 size_ = 0;
+	};
+
+
+	inline ArenaMarker save_marker(Arena const& arena)
+	{
+		ArenaMarker marker{};
+		marker.size_ = arena.size_;
+
+		return marker;
+	}
+
+
+	// releases everything pushed since the marker was saved
+	inline void restore_marker(Arena& arena, ArenaMarker marker)
+	{
+		assert(marker.size_ <= arena.size_);
+
+		if (marker.size_ <= arena.size_)
+		{
+			arena.size_ = marker.size_;
+		}
+	}
+
+
+	// memory owned by the parent and released with it
+	// never call destroy_buffer on a sub arena
+	inline Arena push_sub_arena(Arena& parent, u32 n_bytes, u32 alignment = SIMD_ALIGNMENT)
+	{
+		Arena arena{};
+
+		auto data = push<u8>(parent, n_bytes, alignment);
+		if (data)
+		{
+			arena.data_ = data;
+			arena.capacity_ = n_bytes;
+			arena.size_ = 0;
+		}
+
+		return arena;
+	}
+}
@@ -0,0 +1,75 @@
+#include "profiler.hpp"
+
+#ifdef PROFILER_ON
+
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+
+namespace profiler
+{
+    static std::mutex rings_mutex;
+    static std::vector<ThreadRing*> rings;
+
+
+    ThreadRing* create_thread_ring()
+    {
+        // lives until the program ends so the capture survives its thread
+        auto ring = new ThreadRing();
+
+        std::lock_guard<std::mutex> lock(rings_mutex);
+
+        rings.push_back(ring);
+        ring->thread_id = (u32)rings.size();
+
+        return ring;
+    }
+
+
+    static void write_events(FILE* file, ThreadRing const& ring, bool& first)
+    {
+        auto const n_events = ring.count < RING_CAPACITY ? ring.count : (u64)RING_CAPACITY;
+
+        for (auto i = ring.count - n_events; i < ring.count; i++)
+        {
+            auto const& event = ring.events[i & (RING_CAPACITY - 1)];
+
+            fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                first ? "" : ",",
+                event.name,
+                ring.thread_id,
+                event.begin_ns / 1000.0,
+                (event.end_ns - event.begin_ns) / 1000.0);
+
+            first = false;
+        }
+    }
+
+
+    bool write_chrome_trace(cstr path)
+    {
+        auto file = fopen(path, "w");
+        if (!file)
+        {
+            return false;
+        }
+
+        fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+        bool first = true;
+
+        std::lock_guard<std::mutex> lock(rings_mutex);
+
+        for (auto ring : rings)
+        {
+            write_events(file, *ring, first);
+        }
+
+        fprintf(file, "\n]}\n");
+
+        return fclose(file) == 0;
+    }
+}
+
+#endif
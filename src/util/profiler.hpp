@@ -0,0 +1,117 @@
+#pragma once
+
+#include "types.hpp"
+
+// build with -DPROFILER_ON to record zones
+// otherwise PROFILE_ZONE compiles to nothing
+
+#ifdef PROFILER_ON
+
+#include <chrono>
+
+
+namespace profiler
+{
+    // events kept per thread, oldest are overwritten
+    constexpr u32 RING_CAPACITY = 1u << 15;
+
+    static_assert((RING_CAPACITY & (RING_CAPACITY - 1)) == 0);
+
+
+    class ZoneEvent
+    {
+    public:
+        cstr name;
+        u64 begin_ns;
+        u64 end_ns;
+    };
+
+
+    class ThreadRing
+    {
+    public:
+        ZoneEvent events[RING_CAPACITY];
+
+        // total events pushed, next slot is count % RING_CAPACITY
+        u64 count = 0;
+
+        u32 thread_id = 0;
+    };
+
+
+    ThreadRing* create_thread_ring();
+
+
+    inline ThreadRing& thread_ring()
+    {
+        static thread_local ThreadRing* ring = create_thread_ring();
+
+        return *ring;
+    }
+
+
+    // allocates this thread's ring now instead of in its first zone
+    inline void register_thread()
+    {
+        thread_ring();
+    }
+
+
+    inline u64 now_ns()
+    {
+        using clock = std::chrono::steady_clock;
+
+        static const auto epoch = clock::now();
+
+        return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - epoch).count();
+    }
+
+
+    // records the time from construction to destruction
+    // name must outlive the capture, use a string literal
+    class Zone
+    {
+    public:
+        Zone(cstr name) : name_(name), ring_(thread_ring()), begin_ns_(now_ns()) {}
+
+        ~Zone()
+        {
+            auto& event = ring_.events[ring_.count & (RING_CAPACITY - 1)];
+            event.name = name_;
+            event.begin_ns = begin_ns_;
+            event.end_ns = now_ns();
+
+            ring_.count++;
+        }
+
+        Zone(Zone const&) = delete;
+        Zone& operator=(Zone const&) = delete;
+
+    private:
+        cstr name_;
+        ThreadRing& ring_;
+        u64 begin_ns_;
+    };
+
+
+    // writes the zones of every thread for chrome://tracing or ui.perfetto.dev
+    // no thread can be recording while this runs
+    bool write_chrome_trace(cstr path);
+}
+
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+#define PROFILE_ZONE(name) profiler::Zone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+
+// first thing in each thread that records zones
+#define PROFILE_THREAD() profiler::register_thread()
+
+#else
+
+#define PROFILE_ZONE(name)
+
+#define PROFILE_THREAD()
+
+#endif
@@ -0,0 +1,152 @@
+#include "startup_timer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+
+namespace startup_timer
+{
+    static std::mutex phases_mutex;
+    static Phase phases[MAX_PHASES];
+    static u32 n_phases = 0;
+    static u32 n_dropped = 0;
+
+    static std::thread::id main_thread;
+    static std::thread::id other_threads[MAX_PHASES];
+    static u32 n_other_threads = 0;
+
+
+    u64 now_ns()
+    {
+        using clock = std::chrono::steady_clock;
+
+        static const auto epoch = []()
+        {
+            main_thread = std::this_thread::get_id();
+            return clock::now();
+        }();
+
+        return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - epoch).count();
+    }
+
+
+    // guarded by phases_mutex
+    static u32 thread_id()
+    {
+        auto const id = std::this_thread::get_id();
+        if (id == main_thread)
+        {
+            return 0;
+        }
+
+        for (u32 i = 0; i < n_other_threads; i++)
+        {
+            if (other_threads[i] == id)
+            {
+                return i + 1;
+            }
+        }
+
+        other_threads[n_other_threads++] = id;
+
+        return n_other_threads;
+    }
+
+
+    void record_phase(cstr name, u64 begin_ns, u64 end_ns)
+    {
+        record_phase(name, begin_ns, end_ns, 0);
+    }
+
+
+    void record_phase(cstr name, u64 begin_ns, u64 end_ns, u64 peak_bytes)
+    {
+        std::lock_guard<std::mutex> lock(phases_mutex);
+
+        if (n_phases == MAX_PHASES)
+        {
+            ++n_dropped;
+            return;
+        }
+
+        auto& phase = phases[n_phases++];
+        phase.name = name;
+        phase.begin_ns = begin_ns;
+        phase.end_ns = end_ns;
+        phase.thread_id = thread_id();
+        phase.peak_bytes = peak_bytes;
+    }
+
+
+    static void sort_phases()
+    {
+        std::stable_sort(phases, phases + n_phases, [](Phase const& a, Phase const& b){ return a.begin_ns < b.begin_ns; });
+    }
+
+
+    void print_table()
+    {
+        std::lock_guard<std::mutex> lock(phases_mutex);
+
+        sort_phases();
+
+        printf("%-52s %10s %10s %10s %7s %10s\n", "startup phase", "begin ms", "end ms", "ms", "thread", "peak KB");
+
+        for (u32 i = 0; i < n_phases; i++)
+        {
+            auto const& phase = phases[i];
+
+            printf("%-52s %10.2f %10.2f %10.2f %7u", phase.name,
+                phase.begin_ns / 1e6, phase.end_ns / 1e6, (phase.end_ns - phase.begin_ns) / 1e6, phase.thread_id);
+
+            if (phase.peak_bytes)
+            {
+                printf(" %10llu", (unsigned long long)((phase.peak_bytes + 1023) / 1024));
+            }
+
+            printf("\n");
+        }
+
+        if (n_dropped)
+        {
+            printf("%u phases dropped\n", n_dropped);
+        }
+    }
+
+
+    bool write_json(cstr path)
+    {
+        auto file = fopen(path, "w");
+        if (!file)
+        {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(phases_mutex);
+
+        sort_phases();
+
+        fprintf(file, "{\"phases\":[");
+
+        for (u32 i = 0; i < n_phases; i++)
+        {
+            auto const& phase = phases[i];
+
+            fprintf(file, "%s\n{\"name\":\"%s\",\"begin_ms\":%.3f,\"end_ms\":%.3f,\"ms\":%.3f,\"thread\":%u,\"peak_bytes\":%llu}",
+                i ? "," : "",
+                phase.name,
+                phase.begin_ns / 1e6,
+                phase.end_ns / 1e6,
+                (phase.end_ns - phase.begin_ns) / 1e6,
+                phase.thread_id,
+                (unsigned long long)phase.peak_bytes);
+        }
+
+        fprintf(file, "\n],\"dropped\":%u}\n", n_dropped);
+
+        return fclose(file) == 0;
+    }
+}
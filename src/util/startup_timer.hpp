@@ -0,0 +1,66 @@
+#pragma once
+
+#include "types.hpp"
+
+// wall time of each startup phase, recorded in every build
+// phases can overlap and end on any thread, each is kept when it ends
+// times are from the first now_ns call, make it first thing in main
+
+
+namespace startup_timer
+{
+    // later phases are dropped
+    constexpr u32 MAX_PHASES = 64;
+
+
+    class Phase
+    {
+    public:
+        cstr name;
+        u64 begin_ns;
+        u64 end_ns;
+
+        // 0 on the thread that started the clock
+        u32 thread_id;
+
+        // most memory the phase held at once, 0 when not measured
+        u64 peak_bytes;
+    };
+
+
+    u64 now_ns();
+
+    // name must outlive the report, use a string literal
+    void record_phase(cstr name, u64 begin_ns, u64 end_ns);
+
+    void record_phase(cstr name, u64 begin_ns, u64 end_ns, u64 peak_bytes);
+
+
+    // records the time from construction to destruction
+    class ScopedPhase
+    {
+    public:
+        ScopedPhase(cstr name) : name_(name), begin_ns_(now_ns()) {}
+
+        ~ScopedPhase() { record_phase(name_, begin_ns_, now_ns()); }
+
+        ScopedPhase(ScopedPhase const&) = delete;
+        ScopedPhase& operator=(ScopedPhase const&) = delete;
+
+    private:
+        cstr name_;
+        u64 begin_ns_;
+    };
+
+
+    // phases in the order they began, those still running are not in it
+    void print_table();
+
+    bool write_json(cstr path);
+}
+
+
+#define STARTUP_CONCAT_IMPL(a, b) a##b
+#define STARTUP_CONCAT(a, b) STARTUP_CONCAT_IMPL(a, b)
+
+#define STARTUP_PHASE(name) startup_timer::ScopedPhase STARTUP_CONCAT(startup_phase_, __LINE__)(name)
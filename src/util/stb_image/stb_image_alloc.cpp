@@ -0,0 +1,125 @@
+#include "stb_image_alloc.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+
+namespace stb_image_alloc
+{
+    // what malloc guarantees, stb_image relies on no more
+    constexpr u32 DECODE_ALIGNMENT = 16;
+
+
+    static thread_local Arena* tl_arena = nullptr;
+
+    // arena bytes in use at once since the arena was set
+    static thread_local u32 tl_high_water = 0;
+
+
+    static bool is_in_arena(Arena const& arena, void const* data)
+    {
+        auto const p = (u8 const*)data;
+
+        return p >= arena.data_ && p < arena.data_ + arena.size_;
+    }
+
+
+    static void update_high_water(Arena const& arena)
+    {
+        if (arena.size_ > tl_high_water)
+        {
+            tl_high_water = arena.size_;
+        }
+    }
+
+
+    void set_decode_arena(Arena* arena)
+    {
+        tl_arena = arena;
+        tl_high_water = arena ? arena->size_ : 0;
+    }
+
+
+    Arena* decode_arena()
+    {
+        return tl_arena;
+    }
+
+
+    u32 decode_high_water()
+    {
+        return tl_high_water;
+    }
+
+
+    void* decode_malloc(size_t n_bytes)
+    {
+        if (!tl_arena)
+        {
+            return std::malloc(n_bytes);
+        }
+
+        if (!n_bytes || n_bytes > UINT32_MAX)
+        {
+            return nullptr;
+        }
+
+        auto data = memory_buffer::push<u8>(*tl_arena, (u32)n_bytes, DECODE_ALIGNMENT);
+        update_high_water(*tl_arena);
+
+        return data;
+    }
+
+
+    void* decode_realloc_sized(void* data, size_t old_bytes, size_t new_bytes)
+    {
+        if (!data)
+        {
+            return decode_malloc(new_bytes);
+        }
+
+        if (!tl_arena || !is_in_arena(*tl_arena, data))
+        {
+            return std::realloc(data, new_bytes);
+        }
+
+        auto& arena = *tl_arena;
+        auto const p = (u8*)data;
+
+        // the last block grows in place, zlib output doubles this way
+        if (p + old_bytes == arena.data_ + arena.size_ && new_bytes > old_bytes && new_bytes - old_bytes <= UINT32_MAX)
+        {
+            if (memory_buffer::push<u8>(arena, (u32)(new_bytes - old_bytes), 1))
+            {
+                update_high_water(arena);
+                return data;
+            }
+
+            return nullptr;
+        }
+
+        if (new_bytes <= old_bytes)
+        {
+            return data;
+        }
+
+        auto new_data = decode_malloc(new_bytes);
+        if (new_data)
+        {
+            std::memcpy(new_data, data, old_bytes);
+        }
+
+        return new_data;
+    }
+
+
+    void decode_free(void* data)
+    {
+        if (tl_arena && is_in_arena(*tl_arena, data))
+        {
+            return;
+        }
+
+        std::free(data);
+    }
+}
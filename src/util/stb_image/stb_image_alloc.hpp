@@ -0,0 +1,28 @@
+#pragma once
+
+#include "../memory_buffer.hpp"
+
+#include <cstddef>
+
+
+// STBI_MALLOC, STBI_REALLOC_SIZED and STBI_FREE
+// while a thread has a decode arena every stb_image allocation on it comes from the arena
+// frees do nothing, the arena is released in one step when decoding is done
+// with no arena set the hooks fall back to the heap
+
+namespace stb_image_alloc
+{
+    // nullptr returns the thread to the heap
+    void set_decode_arena(Arena* arena);
+
+    Arena* decode_arena();
+
+    // the most arena bytes in use at once since set_decode_arena
+    u32 decode_high_water();
+
+    void* decode_malloc(size_t n_bytes);
+
+    void* decode_realloc_sized(void* data, size_t old_bytes, size_t new_bytes);
+
+    void decode_free(void* data);
+}
@@ -17,12 +17,10 @@
 //#define STBI_NO_SIMD
 //#define STBI_NEON
 
-/*
-#include "???"
-#define STBI_MALLOC ???
-#define STBI_REALLOC ???
-#define STBI_FREE ???
-*/
+#include "stb_image_alloc.hpp"
+#define STBI_MALLOC(sz) stb_image_alloc::decode_malloc(sz)
+#define STBI_REALLOC_SIZED(p, oldsz, newsz) stb_image_alloc::decode_realloc_sized(p, oldsz, newsz)
+#define STBI_FREE(p) stb_image_alloc::decode_free(p)
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -0,0 +1,179 @@
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cassert>
+
+
+namespace thread_pool
+{
+    class PoolData
+    {
+    public:
+        std::vector<std::thread> workers;
+
+        std::mutex mutex;
+        std::condition_variable job_ready;
+        std::condition_variable job_done;
+
+        // current job, guarded by mutex
+        std::function<void(u32)> const* task = nullptr;
+        u32 n_tasks = 0;
+        u64 generation = 0;
+        u32 n_active = 0;
+        bool is_running = false;
+
+        std::atomic<u32> next_task = 0;
+        std::atomic<u32> n_finished = 0;
+    };
+
+
+    static void run_tasks(PoolData& data, std::function<void(u32)> const* task, u32 n_tasks)
+    {
+        u32 n_done = 0;
+
+        for (auto id = data.next_task++; id < n_tasks; id = data.next_task++)
+        {
+            (*task)(id);
+            ++n_done;
+        }
+
+        if (n_done && data.n_finished.fetch_add(n_done) + n_done == n_tasks)
+        {
+            std::lock_guard<std::mutex> lock(data.mutex);
+            data.job_done.notify_all();
+        }
+    }
+
+
+    static void worker_loop(PoolData& data)
+    {
+        u64 generation = 0;
+
+        while (true)
+        {
+            std::function<void(u32)> const* task = nullptr;
+            u32 n_tasks = 0;
+
+            {
+                std::unique_lock<std::mutex> lock(data.mutex);
+                data.job_ready.wait(lock, [&]() { return !data.is_running || data.generation != generation; });
+
+                if (!data.is_running)
+                {
+                    return;
+                }
+
+                generation = data.generation;
+                task = data.task;
+                n_tasks = data.n_tasks;
+                data.n_active++;
+            }
+
+            run_tasks(data, task, n_tasks);
+
+            std::lock_guard<std::mutex> lock(data.mutex);
+            if (--data.n_active == 0)
+            {
+                data.job_done.notify_all();
+            }
+        }
+    }
+}
+
+
+namespace thread_pool
+{
+    bool create_pool(ThreadPool& pool, u32 n_workers)
+    {
+        assert(!pool.data_);
+
+        if (pool.data_)
+        {
+            return false;
+        }
+
+        auto data = new PoolData();
+        data->is_running = true;
+
+        for (u32 i = 0; i < n_workers; i++)
+        {
+            data->workers.emplace_back(worker_loop, std::ref(*data));
+        }
+
+        pool.data_ = data;
+        pool.n_workers = n_workers;
+
+        return true;
+    }
+
+
+    void destroy_pool(ThreadPool& pool)
+    {
+        if (!pool.data_)
+        {
+            return;
+        }
+
+        auto& data = *pool.data_;
+
+        {
+            std::lock_guard<std::mutex> lock(data.mutex);
+            data.is_running = false;
+        }
+
+        data.job_ready.notify_all();
+
+        for (auto& worker : data.workers)
+        {
+            worker.join();
+        }
+
+        delete pool.data_;
+        pool.data_ = nullptr;
+        pool.n_workers = 0;
+    }
+
+
+    void execute(ThreadPool& pool, u32 n_tasks, std::function<void(u32)> const& task)
+    {
+        if (!n_tasks)
+        {
+            return;
+        }
+
+        if (!pool.data_ || !pool.n_workers || n_tasks == 1)
+        {
+            for (u32 id = 0; id < n_tasks; id++)
+            {
+                task(id);
+            }
+
+            return;
+        }
+
+        auto& data = *pool.data_;
+
+        {
+            // a worker still leaving the previous job must not claim from this one
+            std::unique_lock<std::mutex> lock(data.mutex);
+            data.job_done.wait(lock, [&]() { return data.n_active == 0; });
+
+            data.task = &task;
+            data.n_tasks = n_tasks;
+            data.next_task = 0;
+            data.n_finished = 0;
+            data.generation++;
+        }
+
+        data.job_ready.notify_all();
+
+        run_tasks(data, &task, n_tasks);
+
+        std::unique_lock<std::mutex> lock(data.mutex);
+        data.job_done.wait(lock, [&]() { return data.n_finished == n_tasks; });
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <functional>
+
+
+namespace thread_pool
+{
+    class PoolData;
+
+
+    class ThreadPool
+    {
+    public:
+        u32 n_workers = 0;
+
+        PoolData* data_ = nullptr;
+    };
+
+
+    bool create_pool(ThreadPool& pool, u32 n_workers);
+
+    void destroy_pool(ThreadPool& pool);
+
+    // runs task(0) .. task(n_tasks - 1) on the workers and the calling thread
+    // returns when every task is finished
+    void execute(ThreadPool& pool, u32 n_tasks, std::function<void(u32)> const& task);
+}
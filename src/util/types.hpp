@@ -59,6 +59,9 @@ public:
 
 	T* matrix_data_ = nullptr;
 
+	// elements from one row to the next, can be larger than width
+	u32 matrix_width = 0;
+
 	u32 width = 0;
 	u32 height = 0;
 };
@@ -1,2 +1,8 @@
 #include "qsprintf/qsprintf.cpp"
-#include "stb_image/stb_image_options.hpp"
\ No newline at end of file
+#include "stb_image/stb_image_options.hpp"
+#include "stb_image/stb_image_alloc.cpp"
+#include "thread_pool.cpp"
+#include "profiler.cpp"
+#include "startup_timer.cpp"
+#include "frame_pacer.cpp"
+#include "memory_buffer.cpp"
\ No newline at end of file